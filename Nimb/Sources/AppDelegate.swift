@@ -15,10 +15,11 @@ public class AppDelegate: NSObject, NSApplicationDelegate, Rendering {
 
   private var neovim: Neovim?
   private var store: Store?
+  private var frameScheduler: FrameScheduler?
   @StateActor private var alertsTask: Task<Void, Never>?
   @StateActor private var updatesTask: Task<Void, Never>?
 
-  private nonisolated let pendingStateAndUpdates = LockIsolated<(State, State.Updates)?>(nil)
+  private nonisolated let renderTimings = LockIsolated<StageTimings>(.init())
 
   override public init() {
     super.init()
@@ -42,10 +43,16 @@ public class AppDelegate: NSObject, NSApplicationDelegate, Rendering {
 
     setupInitialControllers(store: store)
 
+    let frameScheduler = FrameScheduler { [unowned self] state, updates in
+      renderFrame(state: state, updates: updates)
+    }
+    frameScheduler.attach(to: mainWindowController!.window!.contentView!)
+    self.frameScheduler = frameScheduler
+
     setupKeyDownMonitor(store: store)
 
     Task { @StateActor in
-      setupBindings(store: store)
+      setupBindings(store: store, frameScheduler: frameScheduler)
 
       let terminationStatus = await neovim.bootstrap()
       logger.debug("Neovim process terminated with status \(terminationStatus)")
@@ -58,6 +65,7 @@ public class AppDelegate: NSObject, NSApplicationDelegate, Rendering {
 
   public func applicationWillTerminate(_: Notification) {
     logger.debug("Application will terminate")
+    store?.cancel()
   }
 
   public func applicationDidBecomeActive(_: Notification) {
@@ -74,8 +82,27 @@ public class AppDelegate: NSObject, NSApplicationDelegate, Rendering {
     render()
   }
 
+  private func renderFrame(state: State, updates: State.Updates) {
+    if updates.isOuterGridLayoutUpdated, let outerGrid = state.outerGrid {
+      UserDefaults.standard.outerGridSize = outerGrid.size
+    }
+    if updates.isFontUpdated {
+      UserDefaults.standard.appKitFont = state.font.appKit()
+    }
+    if updates.isDebugUpdated {
+      UserDefaults.standard.debug = state.debug
+    }
+    if updates.isErrorExitStatusUpdated {
+      logger.error("Neovim process emitted erorr exit UI event with status \(state.errorExitStatus ?? 0)")
+    }
+    let duration = ContinuousClock().measure {
+      render(state: state, updates: updates)
+    }
+    renderTimings.withValue { $0.record(busy: duration) }
+  }
+
   @StateActor
-  private func setupBindings(store: Store) {
+  private func setupBindings(store: Store, frameScheduler: FrameScheduler) {
     alertsTask = Task {
       do {
         for await alert in store.alerts {
@@ -88,10 +115,13 @@ public class AppDelegate: NSObject, NSApplicationDelegate, Rendering {
     updatesTask = Task {
       do {
         var presentedNimbNotifiesCount = 0
+        var lineUpdatesStatistics = State.LineUpdatesStatistics()
 
         for await (state, updates) in store.updates {
           try Task.checkCancellation()
 
+          lineUpdatesStatistics = state.lineUpdatesStatistics
+
           if updates.isNimbNotifiesUpdated {
             for _ in presentedNimbNotifiesCount ..< state.nimbNotifies.count {
               let notification = state.nimbNotifies[presentedNimbNotifiesCount]
@@ -100,46 +130,15 @@ public class AppDelegate: NSObject, NSApplicationDelegate, Rendering {
             presentedNimbNotifiesCount = state.nimbNotifies.count
           }
 
-          let shouldCreateRenderTask = pendingStateAndUpdates.withValue { value in
-            defer {
-              if var (_, updatesAccumulator) = value {
-                updatesAccumulator.formUnion(updates)
-                value = (state, updatesAccumulator)
-              } else {
-                value = (state, updates)
-              }
-            }
-            return value == nil
-          }
-
-          if shouldCreateRenderTask {
-            Task { @MainActor in
-              let stateAndUpdates = pendingStateAndUpdates.withValue { value in
-                defer { value = nil }
-                return value
-              }
-              guard let (state, updates) = stateAndUpdates else {
-                return
-              }
-              if updates.isOuterGridLayoutUpdated, let outerGrid = state.outerGrid {
-                UserDefaults.standard.outerGridSize = outerGrid.size
-              }
-              if updates.isFontUpdated {
-                UserDefaults.standard.appKitFont = state.font.appKit()
-              }
-              if updates.isDebugUpdated {
-                UserDefaults.standard.debug = state.debug
-              }
-              if updates.isErrorExitStatusUpdated {
-                logger.error("Neovim process emitted erorr exit UI event with status \(state.errorExitStatus ?? 0)")
-              }
-              self.render(state: state, updates: updates)
-            }
-          }
+          frameScheduler.submit(state: state, updates: updates)
         }
         logger.debug("Store state updates loop ended")
+        let glyphRunsStatistics = GlyphTables.shared.statistics
+        logger.debug("Glyph runs: \(String(customDumping: glyphRunsStatistics)), fast path fraction: \(glyphRunsStatistics.fastPathFraction)")
+        logger.debug("Pipeline timings, decode: \(String(customDumping: store.api.decodeTimings)), reduction: \(String(customDumping: store.reductionTimings)), render: \(String(customDumping: self.renderTimings.value)), line updates: \(String(customDumping: lineUpdatesStatistics)), draw runs cache: \(String(customDumping: DrawRunsCache.shared.statistics)), row tiles: \(String(customDumping: RowTiles.statistics.value)), frames: \(String(customDumping: frameScheduler.statistics))")
       } catch is CancellationError {
         logger.debug("Store state updates loop cancelled")
+        store.cancel()
       } catch {
         logger.error("Store state updates loop error: \(error)")
         await self.showCriticalAlert(error: error)
@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: MIT
+
+import AppKit
+import ConcurrencyExtras
+
+/// Hands flushed state over to rendering at most once per display refresh.
+///
+/// Flushes arriving while a frame is pending are merged into it with `State.Updates.formUnion`,
+/// and the display link renders the merged frame on its next tick. When nothing was rendered during
+/// the last refresh interval the frame is rendered right away instead, so a flush after idle,
+/// like the echo of a typed key, does not wait for a tick.
+public final class FrameScheduler: NSObject, @unchecked Sendable {
+  public struct Statistics: Sendable {
+    public var flushesCount: Int = 0
+    public var renderedFramesCount: Int = 0
+    /// Flushes merged into an already pending frame.
+    public var mergedFlushesCount: Int = 0
+    /// Frames rendered without waiting for a display link tick.
+    public var immediateFramesCount: Int = 0
+    /// Display refreshes that passed while a frame was pending.
+    public var droppedFramesCount: Int = 0
+  }
+
+  private struct PendingFrame: Sendable {
+    var state: State
+    var updates: State.Updates
+    var firstFlushInstant: ContinuousClock.Instant
+  }
+
+  public var statistics: Statistics {
+    _statistics.value
+  }
+
+  private let pendingFrame = LockIsolated<PendingFrame?>(nil)
+  private let _statistics = LockIsolated(Statistics())
+  private let render: @MainActor (State, State.Updates) -> Void
+  /// Only accessed on the main thread.
+  private var displayLink: CADisplayLink?
+  /// Only accessed on the main thread.
+  private var refreshInterval: Duration = .seconds(1) / 60
+  /// Only accessed on the main thread.
+  private var lastRenderInstant: ContinuousClock.Instant?
+
+  public init(render: @escaping @MainActor (State, State.Updates) -> Void) {
+    self.render = render
+    super.init()
+  }
+
+  /// The display link follows the screen of the window of `view`. Until it is attached, every frame
+  /// is rendered immediately.
+  @MainActor
+  public func attach(to view: NSView) {
+    displayLink?.invalidate()
+    let displayLink = view.displayLink(target: self, selector: #selector(handleDisplayLink(_:)))
+    displayLink.isPaused = true
+    displayLink.add(to: .main, forMode: .common)
+    self.displayLink = displayLink
+  }
+
+  /// Called for every flush, from any thread.
+  public func submit(state: State, updates: State.Updates) {
+    let isFirstPendingFlush = pendingFrame.withValue { pendingFrame in
+      guard var frame = pendingFrame else {
+        pendingFrame = .init(state: state, updates: updates, firstFlushInstant: .now)
+        return true
+      }
+      frame.state = state
+      frame.updates.formUnion(updates)
+      pendingFrame = frame
+      return false
+    }
+    _statistics.withValue { statistics in
+      statistics.flushesCount += 1
+      if !isFirstPendingFlush {
+        statistics.mergedFlushesCount += 1
+      }
+    }
+
+    if isFirstPendingFlush {
+      Task { @MainActor in
+        self.schedule()
+      }
+    }
+  }
+
+  @MainActor
+  private func schedule() {
+    let isIdle = lastRenderInstant.map { $0.duration(to: .now) >= refreshInterval } ?? true
+    if isIdle || displayLink == nil {
+      renderPendingFrame(isImmediate: true)
+    } else {
+      displayLink!.isPaused = false
+    }
+  }
+
+  @MainActor
+  @objc private func handleDisplayLink(_ displayLink: CADisplayLink) {
+    refreshInterval = .seconds(displayLink.targetTimestamp - displayLink.timestamp)
+    if !renderPendingFrame(isImmediate: false) {
+      displayLink.isPaused = true
+    }
+  }
+
+  @MainActor
+  @discardableResult
+  private func renderPendingFrame(isImmediate: Bool) -> Bool {
+    let frame = pendingFrame.withValue { pendingFrame in
+      defer { pendingFrame = nil }
+      return pendingFrame
+    }
+    guard let frame else {
+      return false
+    }
+
+    let droppedFramesCount = Int(frame.firstFlushInstant.duration(to: .now) / refreshInterval)
+    _statistics.withValue { statistics in
+      statistics.renderedFramesCount += 1
+      statistics.droppedFramesCount += droppedFramesCount
+      if isImmediate {
+        statistics.immediateFramesCount += 1
+      }
+    }
+
+    render(frame.state, frame.updates)
+    lastRenderInstant = .now
+    return true
+  }
+}
@@ -21,4 +21,37 @@ extension FileHandle {
       }
     }
   }
+
+  /// Writes all bytes referenced by `vectors` with `writev`, resubmitting the remainder after partial writes.
+  func write(vectors: UnsafeBufferPointer<iovec>) throws {
+    var vectors = Array(vectors)
+    var index = 0
+
+    while index < vectors.count {
+      let count = vectors.withUnsafeBufferPointer { buffer in
+        writev(
+          fileDescriptor,
+          buffer.baseAddress! + index,
+          Int32(min(buffer.count - index, Int(IOV_MAX)))
+        )
+      }
+
+      guard count >= 0 else {
+        if errno == EINTR {
+          continue
+        }
+        throw Failure("writev failed", String(cString: strerror(errno)))
+      }
+
+      var remaining = count
+      while index < vectors.count, remaining >= vectors[index].iov_len {
+        remaining -= vectors[index].iov_len
+        index += 1
+      }
+      if remaining > 0 {
+        vectors[index].iov_base = vectors[index].iov_base.advanced(by: remaining)
+        vectors[index].iov_len -= remaining
+      }
+    }
+  }
 }
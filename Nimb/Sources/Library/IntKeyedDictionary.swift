@@ -1,160 +1,147 @@
 // SPDX-License-Identifier: MIT
 
-import Collections
-
+/// Dictionary for small non negative integer keys, implemented as a sparse set.
+///
+/// Keys and values live in dense arrays, `sparse` maps a key to its dense index. Insertion,
+/// update and removal are O(1): removal moves the last element into the freed dense slot.
+/// Iteration walks the dense arrays, so it follows insertion order until the first removal.
+/// Use `removeValue(forKey:preservingOrder:)` where that order has to survive removals.
 public struct IntKeyedDictionary<Value> {
   public typealias Key = Int
   public typealias Element = (key: Key, value: Value)
 
-  public struct Values: RandomAccessCollection, Sequence {
-    public typealias Element = Value
-
-    private let dictionary: IntKeyedDictionary
-
-    public var count: Int {
-      keysBackingStore.count
-    }
-
-    public var isEmpty: Bool {
-      keysBackingStore.isEmpty
-    }
-
-    public var underestimatedCount: Int {
-      keysBackingStore.underestimatedCount
-    }
-
-    public var startIndex: Key {
-      keysBackingStore.startIndex
-    }
-
-    public var endIndex: Key {
-      keysBackingStore.endIndex
-    }
-
-    private var keysBackingStore: OrderedSet<Key> {
-      dictionary.keysBackingStore
-    }
-
-    private var valuesBackingStore: [Value?] {
-      dictionary.valuesBackingStore
-    }
-
-    init(_ dictionary: IntKeyedDictionary<Value>) {
-      self.dictionary = dictionary
-    }
+  private static var absent: Int {
+    -1
+  }
 
-    public subscript(position: Int) -> Value {
-      let key = keysBackingStore[position]
-      return valuesBackingStore[key]!
-    }
+  private var sparse: [Int]
+  public private(set) var keys: [Key]
+  public private(set) var values: [Value]
 
-    public subscript(bounds: Range<Key>) -> ArraySlice<Value> {
-      let array = keysBackingStore[bounds]
-        .map { valuesBackingStore[$0]! }
+  public var count: Int {
+    keys.count
+  }
 
-      return .init(array)
-    }
+  public var isEmpty: Bool {
+    keys.isEmpty
+  }
 
-    public func makeIterator() -> AnyIterator<Value> {
-      var keysIterator = keysBackingStore.makeIterator()
+  /// Elements the dense arrays and keys the sparse table can hold without reallocating.
+  public var capacity: (dense: Int, sparse: Int) {
+    (keys.capacity, sparse.capacity)
+  }
 
-      return AnyIterator {
-        if let key = keysIterator.next() {
-          valuesBackingStore[key]!
+  public init(minimumCapacity: Int = 0) {
+    sparse = .init(repeating: Self.absent, count: minimumCapacity)
+    keys = []
+    keys.reserveCapacity(minimumCapacity)
+    values = []
+    values.reserveCapacity(minimumCapacity)
+  }
 
-        } else {
-          nil
-        }
+  public subscript(key: Key) -> Value? {
+    get {
+      guard let index = denseIndex(forKey: key) else {
+        return nil
       }
+      return values[index]
     }
 
-    public func distance(from start: Key, to end: Key) -> Int {
-      keysBackingStore.distance(from: start, to: end)
+    set(newValue) {
+      if let newValue {
+        updateValue(newValue, forKey: key)
+      } else {
+        removeValue(forKey: key)
+      }
     }
+  }
 
-    public func formIndex(before i: inout Key) {
-      keysBackingStore.formIndex(before: &i)
-    }
+  public mutating func updateValue(_ value: Value, forKey key: Key) {
+    precondition(key >= 0, "IntKeyedDictionary keys must be non negative")
 
-    public func formIndex(after i: inout Key) {
-      keysBackingStore.formIndex(after: &i)
+    if let index = denseIndex(forKey: key) {
+      values[index] = value
+      return
     }
 
-    public func index(_ i: Key, offsetBy distance: Int) -> Key {
-      keysBackingStore.index(i, offsetBy: distance)
+    if key >= sparse.count {
+      sparse.append(contentsOf: repeatElement(Self.absent, count: key - sparse.count + 1))
     }
+    sparse[key] = keys.count
+    keys.append(key)
+    values.append(value)
+  }
 
-    public func index(
-      _ i: Key,
-      offsetBy distance: Int,
-      limitedBy limit: Key
-    )
-      -> Key?
-    {
-      keysBackingStore.index(i, offsetBy: distance, limitedBy: limit)
+  /// With `preservingOrder` the remaining elements keep their order, at O(n) cost.
+  @discardableResult
+  public mutating func removeValue(
+    forKey key: Key,
+    preservingOrder: Bool = false
+  )
+    -> Value?
+  {
+    guard let index = denseIndex(forKey: key) else {
+      return nil
     }
+    let value = values[index]
+    sparse[key] = Self.absent
 
-    public func index(after i: Key) -> Key {
-      keysBackingStore.index(after: i)
-    }
+    if preservingOrder {
+      keys.remove(at: index)
+      values.remove(at: index)
+      for movedIndex in index ..< keys.count {
+        sparse[keys[movedIndex]] = movedIndex
+      }
 
-    public func index(before i: Key) -> Key {
-      keysBackingStore.index(before: i)
+    } else {
+      let lastIndex = keys.count - 1
+      if index != lastIndex {
+        keys[index] = keys[lastIndex]
+        values[index] = values[lastIndex]
+        sparse[keys[index]] = index
+      }
+      keys.removeLast()
+      values.removeLast()
     }
-  }
-
-  private var keysBackingStore: OrderedSet<Key>
-  private var valuesBackingStore: [Value?]
-
-  public var count: Int {
-    keysBackingStore.count
-  }
 
-  public var isEmpty: Bool {
-    keysBackingStore.isEmpty
-  }
-
-  public var keys: OrderedSet<Key> {
-    keysBackingStore
+    shrinkIfNeeded()
+    return value
   }
 
-  public var values: Values {
-    .init(self)
+  public mutating func removeAll() {
+    sparse = []
+    keys = []
+    values = []
   }
 
-  public init(minimumCapacity: Int = 0) {
-    keysBackingStore = .init(minimumCapacity: minimumCapacity)
-    valuesBackingStore = .init(repeating: nil, count: minimumCapacity)
+  private func denseIndex(forKey key: Key) -> Int? {
+    guard key >= 0, key < sparse.count else {
+      return nil
+    }
+    let index = sparse[key]
+    return index == Self.absent ? nil : index
   }
 
-  public subscript(key: Key) -> Value? {
-    get {
-      key < valuesBackingStore.count ? valuesBackingStore[key] : nil
+  /// Drops absent trailing keys and releases storage once most of it is unused.
+  private mutating func shrinkIfNeeded() {
+    while let last = sparse.last, last == Self.absent {
+      sparse.removeLast()
     }
-
-    set(newValue) {
-      while key >= valuesBackingStore.count {
-        valuesBackingStore += .init(
-          repeating: nil,
-          count: Swift.max(1, valuesBackingStore.count)
-        )
-      }
-
-      keysBackingStore.remove(key)
-      if newValue != nil {
-        keysBackingStore.updateOrAppend(key)
-      }
-
-      valuesBackingStore[key] = newValue
+    if sparse.capacity > 64, sparse.count < sparse.capacity / 4 {
+      sparse = Self.shrunk(sparse)
+    }
+    if keys.capacity > 64, keys.count < keys.capacity / 4 {
+      keys = Self.shrunk(keys)
+      values = Self.shrunk(values)
     }
   }
 
-  @inlinable
-  @discardableResult
-  public mutating func removeValue(forKey key: Key) -> Value? {
-    let value = self[key]
-    self[key] = nil
-    return value
+  /// `Array(array)` would share the existing buffer, so the elements are copied into a new one.
+  private static func shrunk<Element>(_ array: [Element]) -> [Element] {
+    var shrunk = [Element]()
+    shrunk.reserveCapacity(array.count)
+    shrunk.append(contentsOf: array)
+    return shrunk
   }
 }
 
@@ -178,21 +165,24 @@ extension IntKeyedDictionary: Equatable where Value: Equatable {
   )
     -> Bool
   {
-    lhs.keysBackingStore == rhs.keysBackingStore && !lhs.keysBackingStore
-      .contains(where: { key in
-        lhs.valuesBackingStore[key] != rhs.valuesBackingStore[key]
-      })
+    lhs.count == rhs.count && lhs.allSatisfy { key, value in
+      rhs[key] == value
+    }
   }
 }
 
 extension IntKeyedDictionary: Hashable where Value: Hashable {
+  /// Order independent, like `Dictionary`.
   public func hash(into hasher: inout Hasher) {
-    hasher.combine(count)
-
-    for key in keysBackingStore {
-      hasher.combine(key)
-      hasher.combine(valuesBackingStore[key]!)
+    var elementsHash = 0
+    for (key, value) in self {
+      var elementHasher = Hasher()
+      elementHasher.combine(key)
+      elementHasher.combine(value)
+      elementsHash ^= elementHasher.finalize()
     }
+    hasher.combine(count)
+    hasher.combine(elementsHash)
   }
 }
 
@@ -203,24 +193,22 @@ extension IntKeyedDictionary: Sequence {
 
   public struct Iterator: IteratorProtocol {
     private let dictionary: IntKeyedDictionary<Value>
-    private var currentKeyIndex: OrderedSet<Int>.Index
+    private var index = 0
 
     fileprivate init(_ dictionary: IntKeyedDictionary<Value>) {
       self.dictionary = dictionary
-      currentKeyIndex = dictionary.keysBackingStore.startIndex
     }
 
     public mutating func next() -> (key: Int, value: Value)? {
-      guard currentKeyIndex != dictionary.keysBackingStore.endIndex else {
+      guard index < dictionary.keys.count else {
         return nil
       }
-
-      let key = dictionary.keysBackingStore[currentKeyIndex]
-      currentKeyIndex = dictionary.keysBackingStore
-        .index(after: currentKeyIndex)
-
-      let value = dictionary.valuesBackingStore[key]!
-      return (key, value)
+      defer { index += 1 }
+      return (dictionary.keys[index], dictionary.values[index])
     }
   }
+
+  public var underestimatedCount: Int {
+    count
+  }
 }
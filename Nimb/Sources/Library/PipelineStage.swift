@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: MIT
+
+import Collections
+import Foundation
+
+public struct StageTimings: Sendable {
+  public var batchesCount: Int = 0
+  public var busy: Duration = .zero
+  public var maximum: Duration = .zero
+  /// Time producers spent blocked because the stage input was full.
+  public var backpressure: Duration = .zero
+
+  public var average: Duration {
+    batchesCount == 0 ? .zero : busy / batchesCount
+  }
+
+  public mutating func record(busy duration: Duration) {
+    batchesCount += 1
+    busy += duration
+    maximum = max(maximum, duration)
+  }
+}
+
+/// Stage of a processing pipeline that runs `body` for every input on its own thread.
+///
+/// Inputs go through a single queue of `capacity` inputs and are processed in submission order.
+/// `submit(_:)` blocks its producer while the queue is full, so a faster upstream stage is throttled
+/// instead of piling up unbounded work. `submitWithoutWaiting(_:)` is for producers that must never block,
+/// like the main thread, and may grow the queue past `capacity`; it still queues behind earlier inputs,
+/// so a UI action never overtakes neovim batches submitted before it.
+///
+/// The queue is guarded by a condition lock: the deployment target predates the Synchronization module,
+/// and with a single consumer the lock is only contended at the moment of the hand-off.
+public final class PipelineStage<Input: Sendable>: @unchecked Sendable {
+  public var timings: StageTimings {
+    condition.lock()
+    defer { condition.unlock() }
+    return _timings
+  }
+
+  private let condition = NSCondition()
+  private let capacity: Int
+  private var queue: Deque<Input>
+  private var isFinished = false
+  private var _timings = StageTimings()
+
+  public init(
+    name: String,
+    capacity: Int,
+    qualityOfService: QualityOfService = .userInteractive,
+    body: @escaping @Sendable (Input) -> Void,
+    onFinish: @escaping @Sendable () -> Void = { }
+  ) {
+    self.capacity = max(1, capacity)
+    queue = .init(minimumCapacity: self.capacity)
+
+    let thread = Thread { [self] in
+      while let input = next() {
+        let duration = ContinuousClock().measure {
+          body(input)
+        }
+        condition.lock()
+        _timings.record(busy: duration)
+        condition.unlock()
+      }
+      onFinish()
+    }
+    thread.name = name
+    thread.qualityOfService = qualityOfService
+    thread.start()
+  }
+
+  public func submit(_ input: Input) {
+    condition.lock()
+    defer { condition.unlock() }
+
+    if queue.count >= capacity {
+      let waitingDuration = ContinuousClock().measure {
+        while queue.count >= capacity, !isFinished {
+          condition.wait()
+        }
+      }
+      _timings.backpressure += waitingDuration
+    }
+    guard !isFinished else {
+      return
+    }
+
+    queue.append(input)
+    condition.broadcast()
+  }
+
+  public func submitWithoutWaiting(_ input: Input) {
+    condition.lock()
+    defer { condition.unlock() }
+
+    guard !isFinished else {
+      return
+    }
+    queue.append(input)
+    condition.broadcast()
+  }
+
+  /// Lets the stage process already submitted inputs and then stop.
+  public func finish() {
+    condition.lock()
+    defer { condition.unlock() }
+
+    isFinished = true
+    condition.broadcast()
+  }
+
+  private func next() -> Input? {
+    condition.lock()
+    defer { condition.unlock() }
+
+    while true {
+      if let input = queue.popFirst() {
+        condition.broadcast()
+        return input
+      }
+      if isFinished {
+        return nil
+      }
+      condition.wait()
+    }
+  }
+}
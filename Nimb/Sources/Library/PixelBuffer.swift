@@ -0,0 +1,236 @@
+// SPDX-License-Identifier: MIT
+
+/// Opaque RGBA image with 8 bits per channel and a top left origin, drawn to on the CPU.
+///
+/// Does not depend on CoreGraphics or AppKit, so rasterized frames can be produced and compared
+/// on any platform. Colors are straight RGBA, translucent ones are blended over the existing pixels
+/// with SIMD arithmetic, four pixels at a time for fills. Every drawing operation is limited
+/// to `clipRectangle`.
+public struct PixelBuffer: Sendable {
+  public typealias Pixel = SIMD4<UInt8>
+
+  @PublicInit
+  public struct Rectangle: Sendable, Hashable {
+    public var x: Range<Int>
+    public var y: Range<Int>
+
+    public var isEmpty: Bool {
+      x.isEmpty || y.isEmpty
+    }
+
+    public func intersection(with rectangle: Rectangle) -> Rectangle {
+      .init(x: x.clamped(to: rectangle.x), y: y.clamped(to: rectangle.y))
+    }
+  }
+
+  /// Result of comparing two buffers of equal size, accumulated over any number of comparisons.
+  @PublicInit
+  public struct Difference: Sendable, Hashable {
+    public var pixelsCount: Int = 0
+    /// Pixels with a channel differing by more than the tolerance of the comparison.
+    public var differingPixelsCount: Int = 0
+    public var maximumChannelDifference: Int = 0
+
+    public var differingPixelsFraction: Double {
+      pixelsCount == 0 ? 0 : Double(differingPixelsCount) / Double(pixelsCount)
+    }
+
+    public mutating func formUnion(_ other: Difference) {
+      pixelsCount += other.pixelsCount
+      differingPixelsCount += other.differingPixelsCount
+      maximumChannelDifference = max(maximumChannelDifference, other.maximumChannelDifference)
+    }
+  }
+
+  public private(set) var width: Int
+  public private(set) var height: Int
+  public private(set) var pixels: [Pixel]
+  /// `nil` means the whole buffer.
+  public var clipRectangle: Rectangle?
+
+  public var bounds: Rectangle {
+    .init(x: 0 ..< width, y: 0 ..< height)
+  }
+
+  private var effectiveClipRectangle: Rectangle {
+    clipRectangle?.intersection(with: bounds) ?? bounds
+  }
+
+  public init(width: Int, height: Int, color: Pixel = .init(0, 0, 0, 255)) {
+    self.width = max(0, width)
+    self.height = max(0, height)
+    pixels = .init(repeating: color, count: self.width * self.height)
+  }
+
+  /// `pixels` are rows from top to bottom.
+  public init(width: Int, height: Int, pixels: [Pixel]) {
+    precondition(width >= 0 && height >= 0 && pixels.count == width * height, "Pixels do not match buffer size")
+    self.width = width
+    self.height = height
+    self.pixels = pixels
+  }
+
+  public subscript(x: Int, y: Int) -> Pixel {
+    pixels[y * width + x]
+  }
+
+  /// Fills `rectangle` with `color`, blending when `color` is translucent.
+  public mutating func fill(_ rectangle: Rectangle, color: Pixel) {
+    let rectangle = rectangle.intersection(with: effectiveClipRectangle)
+    guard !rectangle.isEmpty, color.w > 0 else {
+      return
+    }
+    let width = width
+
+    if color.w == 255 {
+      pixels.withUnsafeMutableBufferPointer { pixels in
+        for y in rectangle.y {
+          let start = y * width
+          UnsafeMutableBufferPointer(
+            rebasing: pixels[start + rectangle.x.lowerBound ..< start + rectangle.x.upperBound]
+          )
+          .update(repeating: color)
+        }
+      }
+      return
+    }
+
+    let alpha = UInt16(color.w)
+    let source = SIMD4<UInt16>(truncatingIfNeeded: color) &* alpha
+    let inverseAlpha = 255 - alpha
+    let wideSource = SIMD16<UInt16>(
+      lowHalf: .init(lowHalf: source, highHalf: source),
+      highHalf: .init(lowHalf: source, highHalf: source)
+    )
+
+    pixels.withUnsafeMutableBytes { bytes in
+      let stride = MemoryLayout<Pixel>.stride
+      for y in rectangle.y {
+        var x = rectangle.x.lowerBound
+        while x + 4 <= rectangle.x.upperBound {
+          let offset = (y * width + x) * stride
+          let destination = bytes.loadUnaligned(fromByteOffset: offset, as: SIMD16<UInt8>.self)
+          let blended = Self.blend(
+            .init(truncatingIfNeeded: destination),
+            premultipliedSource: wideSource,
+            inverseAlpha: .init(repeating: inverseAlpha)
+          )
+          bytes.storeBytes(of: SIMD16<UInt8>(truncatingIfNeeded: blended), toByteOffset: offset, as: SIMD16<UInt8>.self)
+          x += 4
+        }
+        while x < rectangle.x.upperBound {
+          let offset = (y * width + x) * stride
+          let destination = bytes.loadUnaligned(fromByteOffset: offset, as: Pixel.self)
+          let blended = Self.blend(
+            .init(truncatingIfNeeded: destination),
+            premultipliedSource: source,
+            inverseAlpha: .init(repeating: inverseAlpha)
+          )
+          bytes.storeBytes(of: Pixel(truncatingIfNeeded: blended), toByteOffset: offset, as: Pixel.self)
+          x += 1
+        }
+      }
+    }
+  }
+
+  /// Blends `color` through the coverage of `mask` placed with its origin at `x`, `y`.
+  public mutating func blend(_ mask: AlphaMask, x: Int, y: Int, color: Pixel) {
+    let maskRectangle = Rectangle(
+      x: x + mask.left ..< x + mask.left + mask.width,
+      y: y + mask.top ..< y + mask.top + mask.height
+    )
+    let rectangle = maskRectangle.intersection(with: effectiveClipRectangle)
+    guard !rectangle.isEmpty, color.w > 0 else {
+      return
+    }
+    let width = width
+    let color16 = SIMD4<UInt16>(truncatingIfNeeded: color)
+
+    pixels.withUnsafeMutableBufferPointer { pixels in
+      for pixelY in rectangle.y {
+        let maskRowStart = (pixelY - maskRectangle.y.lowerBound) * mask.width - maskRectangle.x.lowerBound
+        for pixelX in rectangle.x {
+          let coverage = UInt16(mask.coverage[maskRowStart + pixelX])
+          guard coverage > 0 else {
+            continue
+          }
+          let alpha = (coverage * color16.w + 127) / 255
+          let index = pixelY * width + pixelX
+          let blended = Self.blend(
+            .init(truncatingIfNeeded: pixels[index]),
+            premultipliedSource: color16 &* alpha,
+            inverseAlpha: .init(repeating: 255 - alpha)
+          )
+          pixels[index] = .init(truncatingIfNeeded: blended)
+        }
+      }
+    }
+  }
+
+  /// Draws a one pixel wide line with a simple DDA, used for decorations like undercurl.
+  public mutating func drawLine(
+    from start: (x: Double, y: Double),
+    to end: (x: Double, y: Double),
+    color: Pixel
+  ) {
+    let deltaX = end.x - start.x
+    let deltaY = end.y - start.y
+    let stepsCount = max(1, Int(max(abs(deltaX), abs(deltaY)).rounded(.up)))
+    for step in 0 ... stepsCount {
+      let fraction = Double(step) / Double(stepsCount)
+      let x = Int((start.x + deltaX * fraction).rounded(.down))
+      let y = Int((start.y + deltaY * fraction).rounded(.down))
+      fill(.init(x: x ..< x + 1, y: y ..< y + 1), color: color)
+    }
+  }
+
+  /// Returns `nil` when sizes differ.
+  public func difference(from other: PixelBuffer, tolerance: UInt8) -> Difference? {
+    guard width == other.width, height == other.height else {
+      return nil
+    }
+    var difference = Difference(pixelsCount: pixels.count)
+    for (pixel, otherPixel) in zip(pixels, other.pixels) {
+      let channelDifferences = SIMD4<Int16>(truncatingIfNeeded: pixel) &- SIMD4<Int16>(truncatingIfNeeded: otherPixel)
+      let maximumChannelDifference = Int(
+        channelDifferences.replacing(with: 0 &- channelDifferences, where: channelDifferences .< 0).max()
+      )
+      if maximumChannelDifference > Int(tolerance) {
+        difference.differingPixelsCount += 1
+      }
+      difference.maximumChannelDifference = max(difference.maximumChannelDifference, maximumChannelDifference)
+    }
+    return difference
+  }
+
+  /// Exact rounding division by 255 of `premultipliedSource + destination * inverseAlpha`.
+  @inline(__always)
+  private static func blend<Vector: SIMD>(
+    _ destination: Vector,
+    premultipliedSource: Vector,
+    inverseAlpha: Vector
+  )
+    -> Vector where Vector.Scalar == UInt16
+  {
+    let value = premultipliedSource &+ destination &* inverseAlpha &+ 128
+    return (value &+ (value &>> 8)) &>> 8
+  }
+}
+
+extension PixelBuffer: Equatable {
+  /// Compares pixels only, the clip rectangle is drawing state.
+  public static func == (lhs: PixelBuffer, rhs: PixelBuffer) -> Bool {
+    lhs.width == rhs.width && lhs.height == rhs.height && lhs.pixels == rhs.pixels
+  }
+}
+
+/// Coverage of a rasterized glyph, one byte per pixel, rows from top to bottom.
+@PublicInit
+public struct AlphaMask: Sendable, Hashable {
+  public var width: Int
+  public var height: Int
+  /// Offset of the top left pixel from the glyph origin on the baseline, `top` grows downwards.
+  public var left: Int
+  public var top: Int
+  public var coverage: [UInt8]
+}
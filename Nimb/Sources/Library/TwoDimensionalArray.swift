@@ -2,74 +2,187 @@
 
 import Foundation
 
+/// Elements are stored row after row in a single contiguous buffer with a stride of `columnsCount`.
+///
+/// Logical rows are mapped to physical rows through `rowMap`, so rotating a range of rows
+/// only permutes row indices and never moves elements.
 public struct TwoDimensionalArray<Element> {
-  public var rows: [[Element]]
-  public internal(set) var columnsCount: Int
+  public typealias Row = ArraySlice<Element>
+
+  public private(set) var columnsCount: Int
+  public private(set) var rowsCount: Int
+
+  @usableFromInline
+  var elements: [Element]
+
+  @usableFromInline
+  var rowMap: [Int]
 
   @inlinable
   public var size: IntegerSize {
     .init(
       columnsCount: columnsCount,
-      rowsCount: rows.count
+      rowsCount: rowsCount
     )
   }
 
-  @inlinable
-  public var rowsCount: Int {
-    rows.count
+  public var rows: LazyMapCollection<Range<Int>, Row> {
+    (0 ..< rowsCount).lazy.map { self[row: $0] }
   }
 
-  @inlinable
   public init(
     size: IntegerSize,
     repeatingElement: Element
   ) {
-    self.init(
-      size: size,
-      elementAtPoint: { _ in
-        repeatingElement
-      }
-    )
+    Self.validate(size: size)
+
+    columnsCount = size.columnsCount
+    rowsCount = size.rowsCount
+    elements = .init(repeating: repeatingElement, count: size.columnsCount * size.rowsCount)
+    rowMap = .init(0 ..< size.rowsCount)
   }
 
   public init(
     size: IntegerSize,
     elementAtPoint: (IntegerPoint) -> Element
   ) {
-    if size.columnsCount < 0 {
-      preconditionFailure("size.columnsCount must be non negative")
-    }
-    if size.rowsCount < 0 {
-      preconditionFailure("size.rowsCount must be non negative")
-    }
+    Self.validate(size: size)
 
-    var rows = [[Element]]()
-    for rowIndex in 0 ..< size.rowsCount {
-      var row = [Element]()
-      for columnIndex in 0 ..< size.columnsCount {
-        let element = elementAtPoint(
-          .init(column: columnIndex, row: rowIndex)
-        )
-        row.append(element)
+    var elements = [Element]()
+    elements.reserveCapacity(size.columnsCount * size.rowsCount)
+    for row in 0 ..< size.rowsCount {
+      for column in 0 ..< size.columnsCount {
+        elements.append(elementAtPoint(.init(column: column, row: row)))
       }
-      rows.append(row)
     }
 
-    self.rows = rows
     columnsCount = size.columnsCount
+    rowsCount = size.rowsCount
+    self.elements = elements
+    rowMap = .init(0 ..< size.rowsCount)
   }
 
   @inlinable
   public subscript(point: IntegerPoint) -> Element {
     get {
-      rows[point.row][point.column]
+      elements[rowMap[point.row] * columnsCount + point.column]
     }
     set {
-      rows[point.row][point.column] = newValue
+      elements[rowMap[point.row] * columnsCount + point.column] = newValue
+    }
+  }
+
+  /// Slice indices are offsets into the underlying storage, use `subscript(row:columns:)`
+  /// or `row.dropFirst(_:)` to address columns.
+  @inlinable
+  public subscript(row row: Int) -> Row {
+    let start = rowMap[row] * columnsCount
+    return elements[start ..< start + columnsCount]
+  }
+
+  @inlinable
+  public subscript(row row: Int, columns columns: Range<Int>) -> Row {
+    let start = rowMap[row] * columnsCount
+    return elements[start + columns.lowerBound ..< start + columns.upperBound]
+  }
+
+  /// Replaces elements in `columns` of `row`, `newElements` must have exactly `columns.count` elements.
+  public mutating func replaceSubrange(
+    _ columns: Range<Int>,
+    inRow row: Int,
+    with newElements: some Collection<Element>
+  ) {
+    precondition(
+      newElements.count == columns.count,
+      "replacing elements must not change row length"
+    )
+
+    var index = rowMap[row] * columnsCount + columns.lowerBound
+    for element in newElements {
+      elements[index] = element
+      index += 1
+    }
+  }
+
+  /// Moves elements inside `rectangle` with memmove semantics: every point `point` of the region
+  /// that stays inside `rectangle` receives the element previously at `point + offset`.
+  /// Elements left behind keep their old values.
+  public mutating func moveElements(in rectangle: IntegerRectangle, by offset: IntegerSize) {
+    let target = rectangle
+      .applying(offset: -offset)
+      .intersection(with: rectangle)
+    guard target.size.columnsCount > 0, target.size.rowsCount > 0 else {
+      return
+    }
+
+    // Iterating in the direction of the offset reads every source element before it is overwritten.
+    let rows = offset.rowsCount >= 0
+      ? Array(target.rows)
+      : Array(target.rows.reversed())
+    let columns = offset.columnsCount >= 0
+      ? Array(target.columns)
+      : Array(target.columns.reversed())
+
+    let rowMap = rowMap
+    let columnsCount = columnsCount
+    elements.withUnsafeMutableBufferPointer { elements in
+      for row in rows {
+        let sourceStart = rowMap[row + offset.rowsCount] * columnsCount + offset.columnsCount
+        let targetStart = rowMap[row] * columnsCount
+        for column in columns {
+          elements[targetStart + column] = elements[sourceStart + column]
+        }
+      }
+    }
+  }
+
+  /// After rotation every logical row `row` in `rows` shows what previously was at row `row + offset`,
+  /// with rows wrapping around inside the range. Only row indices are permuted.
+  public mutating func rotateRows(in rows: Range<Int>, by offset: Int) {
+    rowMap.rotate(in: rows, by: offset)
+  }
+
+  private static func validate(size: IntegerSize) {
+    if size.columnsCount < 0 {
+      preconditionFailure("size.columnsCount must be non negative")
+    }
+    if size.rowsCount < 0 {
+      preconditionFailure("size.rowsCount must be non negative")
     }
   }
 }
 
 extension TwoDimensionalArray: Sendable where Element: Sendable { }
 
-extension TwoDimensionalArray: Equatable where Element: Equatable { }
+extension TwoDimensionalArray: Equatable where Element: Equatable {
+  public static func == (lhs: Self, rhs: Self) -> Bool {
+    guard lhs.size == rhs.size else {
+      return false
+    }
+    if lhs.rowMap == rhs.rowMap {
+      return lhs.elements == rhs.elements
+    }
+    return (0 ..< lhs.rowsCount).allSatisfy { row in
+      lhs[row: row].elementsEqual(rhs[row: row])
+    }
+  }
+}
+
+extension Array {
+  /// Rotates elements in `range` so that the element at `range.lowerBound + offset` becomes first,
+  /// `offset` is taken modulo `range.count` and may be negative.
+  mutating func rotate(in range: Range<Int>, by offset: Int) {
+    guard range.count > 1 else {
+      return
+    }
+    let shift = ((offset % range.count) + range.count) % range.count
+    guard shift != 0 else {
+      return
+    }
+    let pivot = range.lowerBound + shift
+    replaceSubrange(
+      range,
+      with: Array(self[pivot ..< range.upperBound] + self[range.lowerBound ..< pivot])
+    )
+  }
+}
@@ -10,6 +10,10 @@ import Queue
 public class GridLayer: CALayer, Rendering, @unchecked Sendable {
   private let gridID: Grid.ID
   private let store: Store
+  /// Only accessed on the main thread.
+  private let drawRuns = GridDrawRuns()
+  /// Only accessed on the main thread.
+  private let rowTiles = RowTiles()
 
   @MainActor
   public var grid: Grid? {
@@ -28,6 +32,19 @@ public class GridLayer: CALayer, Rendering, @unchecked Sendable {
       .translatedBy(x: 0, y: -Double(grid.rowsCount) * state.font.cellHeight)
   }
 
+  /// Background color of the layer itself, cells of this color are not filled when drawing.
+  /// Floating grids may be blended over other grids, so they keep a transparent layer.
+  @MainActor
+  private var clearedBackgroundColor: Color? {
+    guard let grid else {
+      return nil
+    }
+    if case .floating = grid.associatedWindow {
+      return nil
+    }
+    return state.appearance.defaultBackgroundColor
+  }
+
   override public init(layer: Any) {
     let gridLayer = layer as! GridLayer
     gridID = gridLayer.gridID
@@ -68,38 +85,75 @@ public class GridLayer: CALayer, Rendering, @unchecked Sendable {
         cellSize: state.font.cellSize
       )
 
-      ctx.setAllowsAntialiasing(false)
-      ctx.setAllowsFontSmoothing(false)
-      ctx.setShouldAntialias(false)
-      ctx.setShouldSmoothFonts(false)
-      grid.drawRuns.drawBackground(
-        to: ctx,
-        boundingRect: boundingRect,
-        font: state.font,
-        appearance: state.appearance,
-        upsideDownTransform: upsideDownTransform
-      )
+      rowTiles.beginDrawing()
+      defer { rowTiles.endDrawing() }
 
-      ctx.setAllowsAntialiasing(true)
-      ctx.setAllowsFontSmoothing(true)
-      ctx.setShouldAntialias(true)
-      ctx.setShouldSmoothFonts(true)
-      grid.drawRuns.drawForeground(
-        to: ctx,
-        boundingRect: boundingRect,
-        font: state.font,
-        appearance: state.appearance,
-        upsideDownTransform: upsideDownTransform
+      let rows = boundingRect.rows.clamped(to: 0 ..< grid.rowsCount)
+      let missingRows = rowTiles.missingRows(in: rows, layout: grid.layout)
+      if let firstMissingRow = missingRows.first, let lastMissingRow = missingRows.last {
+        // Tiles also draw glyphs of the neighbouring rows.
+        drawRuns.prepareRows(
+          max(firstMissingRow - 1, 0) ..< min(lastMissingRow + 2, grid.rowsCount),
+          layout: grid.layout,
+          font: state.font,
+          appearance: state.appearance
+        )
+      }
+
+      let rowSize = CGSize(
+        width: Double(grid.columnsCount) * state.font.cellWidth,
+        height: state.font.cellHeight
       )
+      ctx.interpolationQuality = .none
+      for row in rows {
+        let rowRectangle = IntegerRectangle(
+          origin: .init(column: 0, row: row),
+          size: .init(columnsCount: grid.columnsCount, rowsCount: 1)
+        )
+        let tile = rowTiles.tile(
+          forRow: row,
+          layout: grid.layout,
+          size: rowSize,
+          scale: contentsScale
+        ) { tileContext in
+          drawRow(
+            row,
+            to: tileContext,
+            grid: grid,
+            upsideDownTransform: .init(scaleX: 1, y: -1)
+              .translatedBy(x: 0, y: -Double(row + 1) * state.font.cellHeight)
+          )
+        }
+        guard let tile else {
+          continue
+        }
+        let rowRect = (rowRectangle * state.font.cellSize).applying(upsideDownTransform)
+        ctx.draw(
+          tile,
+          in: .init(
+            x: rowRect.minX,
+            y: rowRect.maxY - Double(tile.height) / contentsScale,
+            width: Double(tile.width) / contentsScale,
+            height: Double(tile.height) / contentsScale
+          )
+        )
+      }
 
       if
         state.cursorBlinkingPhase,
         state.isMouseUserInteractionEnabled,
-        let cursorDrawRun = grid.drawRuns.cursorDrawRun,
-        boundingRect.contains(cursorDrawRun.origin)
+        let cursorDrawRun = grid.cursorDrawRun,
+        boundingRect.contains(cursorDrawRun.origin),
+        cursorDrawRun.origin.row < grid.rowsCount
       {
         cursorDrawRun.draw(
           to: ctx,
+          rowDrawRun: drawRuns.rowDrawRun(
+            forRow: cursorDrawRun.origin.row,
+            layout: grid.layout,
+            font: state.font,
+            appearance: state.appearance
+          ),
           font: state.font,
           appearance: state.appearance,
           upsideDownTransform: upsideDownTransform
@@ -108,16 +162,65 @@ public class GridLayer: CALayer, Rendering, @unchecked Sendable {
     }
   }
 
+  /// Draws backgrounds of `row` and foregrounds of `row` and its neighbours, whose overhanging
+  /// glyphs and decorations are clipped by the context.
+  @MainActor
+  private func drawRow(
+    _ row: Int,
+    to context: CGContext,
+    grid: Grid,
+    upsideDownTransform: CGAffineTransform
+  ) {
+    drawRuns.draw(
+      to: context,
+      layout: grid.layout,
+      backgroundRect: .init(
+        origin: .init(column: 0, row: row),
+        size: .init(columnsCount: grid.columnsCount, rowsCount: 1)
+      ),
+      foregroundRect: .init(
+        origin: .init(column: 0, row: row - 1),
+        size: .init(columnsCount: grid.columnsCount, rowsCount: 3)
+      ),
+      font: state.font,
+      appearance: state.appearance,
+      clearedBackgroundColor: clearedBackgroundColor,
+      upsideDownTransform: upsideDownTransform
+    )
+  }
+
   @MainActor
   public func render() {
-    for dirtyRect in calculateDirtyRects() {
+    let backgroundCGColor = clearedBackgroundColor != nil ?
+      state.appearance.defaultStyle.backgroundCGColor :
+      nil
+    if backgroundColor != backgroundCGColor {
+      backgroundColor = backgroundCGColor
+      rowTiles.removeAll()
+      setNeedsDisplay()
+    }
+
+    var redefinedHighlightRows = [Int]()
+    if updates.isFontUpdated || updates.isAppearanceUpdated {
+      drawRuns.removeAll()
+      rowTiles.removeAll()
+    } else if let grid {
+      // Newly defined highlights are not used by any row yet, only redefined ones invalidate rows.
+      redefinedHighlightRows = grid.layout.rows(usingHighlightIDs: updates.redefinedHighlightIDs)
+      let revisions = Set(redefinedHighlightRows.map { grid.layout.rowLayouts[$0].revision })
+      drawRuns.remove(revisions: revisions)
+      rowTiles.removeTiles(containing: revisions)
+      drawRuns.removeUnused(for: grid.layout)
+    }
+
+    for dirtyRect in calculateDirtyRects(redefinedHighlightRows: redefinedHighlightRows) {
       setNeedsDisplay(dirtyRect)
     }
     displayIfNeeded()
   }
 
   @MainActor
-  private func calculateDirtyRects() -> [CGRect] {
+  private func calculateDirtyRects(redefinedHighlightRows: [Int]) -> [CGRect] {
     guard isRendered, let grid, let upsideDownTransform else {
       return []
     }
@@ -144,8 +247,20 @@ public class GridLayer: CALayer, Rendering, @unchecked Sendable {
       }
     }
 
+    for row in redefinedHighlightRows {
+      let rectangle = IntegerRectangle(
+        origin: .init(column: 0, row: row),
+        size: .init(columnsCount: grid.columnsCount, rowsCount: 1)
+      )
+      dirtyRects.append(
+        (rectangle * state.font.cellSize)
+          .insetBy(dx: 0, dy: -state.font.cellSize.height * 0.5)
+          .applying(upsideDownTransform)
+      )
+    }
+
     if
-      let cursorDrawRun = grid.drawRuns.cursorDrawRun,
+      let cursorDrawRun = grid.cursorDrawRun,
       updates.isCursorBlinkingPhaseUpdated || updates.isMouseUserInteractionEnabledUpdated
     {
       dirtyRects.append(
@@ -0,0 +1,187 @@
+// SPDX-License-Identifier: MIT
+
+import AppKit
+import ConcurrencyExtras
+
+/// Rasterized rows of a grid keyed by the layout revisions of the row and its neighbours.
+///
+/// Revisions follow rows when they move, so after `grid_scroll` the scrolled region is blitted
+/// from existing tiles and only newly exposed, changed or adjacent rows are rasterized. A tile holds
+/// the backgrounds of its row and the decorations and glyphs of the row and both neighbours,
+/// clipped to the row, so accents, icons and descenders overhanging from adjacent rows are kept.
+/// The cursor is drawn over tiles. Not thread safe, meant to be owned by a single layer.
+final class RowTiles {
+  struct Key: Hashable {
+    var previous: RowLayout.Revision?
+    var row: RowLayout.Revision
+    var next: RowLayout.Revision?
+
+    init(row: Int, layout: GridLayout) {
+      previous = row > 0 ? layout.rowLayouts[row - 1].revision : nil
+      self.row = layout.rowLayouts[row].revision
+      next = row + 1 < layout.rowsCount ? layout.rowLayouts[row + 1].revision : nil
+    }
+  }
+
+  struct Statistics: Sendable {
+    var hitsCount: Int = 0
+    var missesCount: Int = 0
+    var evictionsCount: Int = 0
+    var tilesCount: Int = 0
+    var bytesCount: Int = 0
+  }
+
+  private struct Tile {
+    var image: CGImage
+    var lastUseIndex: Int
+
+    var bytesCount: Int {
+      image.bytesPerRow * image.height
+    }
+  }
+
+  /// Totals of all grid layers.
+  static let statistics = LockIsolated(Statistics())
+
+  /// Budget of a single layer. Tiles used by the draw pass in progress are kept even beyond it.
+  static let maximumBytesCount = 16 * 1024 * 1024
+
+  private var tiles = [Key: Tile]()
+  private var bytesCount = 0
+  private var scale: Double = 1
+  private var useIndex = 0
+  private var drawingStartUseIndex = 0
+
+  deinit {
+    removeAll()
+  }
+
+  /// Tiles depend on font, appearance and scale, so they are dropped when those change.
+  func removeAll() {
+    Self.recordRemoval(of: tiles.values, isEviction: false)
+    tiles.removeAll(keepingCapacity: true)
+    bytesCount = 0
+  }
+
+  /// Drops tiles of rows with any of `revisions` and of their neighbours, which draw over them.
+  func removeTiles(containing revisions: Set<RowLayout.Revision>) {
+    guard !revisions.isEmpty else {
+      return
+    }
+    var removedTiles = [Tile]()
+    for key in tiles.keys where revisions.contains(key.row)
+      || key.previous.map(revisions.contains) == true
+      || key.next.map(revisions.contains) == true
+    {
+      let tile = tiles.removeValue(forKey: key)!
+      bytesCount -= tile.bytesCount
+      removedTiles.append(tile)
+    }
+    Self.recordRemoval(of: removedTiles, isEviction: false)
+  }
+
+  func beginDrawing() {
+    drawingStartUseIndex = useIndex
+  }
+
+  /// Evicts least recently used tiles until the layer fits its budget again.
+  func endDrawing() {
+    guard bytesCount > Self.maximumBytesCount else {
+      return
+    }
+    let candidates = tiles
+      .filter { $0.value.lastUseIndex < drawingStartUseIndex }
+      .sorted { $0.value.lastUseIndex < $1.value.lastUseIndex }
+    var evictedTiles = [Tile]()
+    for (key, tile) in candidates {
+      guard bytesCount > Self.maximumBytesCount else {
+        break
+      }
+      tiles.removeValue(forKey: key)
+      bytesCount -= tile.bytesCount
+      evictedTiles.append(tile)
+    }
+    Self.recordRemoval(of: evictedTiles, isEviction: true)
+  }
+
+  func missingRows(in rows: Range<Int>, layout: GridLayout) -> [Int] {
+    rows.filter { tiles[.init(row: $0, layout: layout)] == nil }
+  }
+
+  /// Returns the tile of `row`, calling `draw` to rasterize it when there is none yet.
+  ///
+  /// `draw` gets a context sized `size` in points, with the origin at the bottom left corner of the row.
+  func tile(
+    forRow row: Int,
+    layout: GridLayout,
+    size: CGSize,
+    scale: Double,
+    draw: (CGContext) -> Void
+  )
+    -> CGImage?
+  {
+    if scale != self.scale {
+      removeAll()
+      self.scale = scale
+    }
+    useIndex += 1
+
+    let key = Key(row: row, layout: layout)
+    let pixelWidth = Int((size.width * scale).rounded(.up))
+    let pixelHeight = Int((size.height * scale).rounded(.up))
+    if let tile = tiles[key], tile.image.width == pixelWidth, tile.image.height == pixelHeight {
+      tiles[key]!.lastUseIndex = useIndex
+      Self.statistics.withValue { $0.hitsCount += 1 }
+      return tile.image
+    }
+
+    guard
+      pixelWidth > 0, pixelHeight > 0,
+      let context = CGContext(
+        data: nil,
+        width: pixelWidth,
+        height: pixelHeight,
+        bitsPerComponent: 8,
+        bytesPerRow: 0,
+        space: CGColorSpaceCreateDeviceRGB(),
+        bitmapInfo: CGImageAlphaInfo.premultipliedFirst.rawValue | CGBitmapInfo.byteOrder32Little.rawValue
+      )
+    else {
+      return nil
+    }
+    context.scaleBy(x: scale, y: scale)
+    draw(context)
+    guard let image = context.makeImage() else {
+      return nil
+    }
+
+    let tile = Tile(image: image, lastUseIndex: useIndex)
+    if let replacedTile = tiles.updateValue(tile, forKey: key) {
+      bytesCount -= replacedTile.bytesCount
+      Self.recordRemoval(of: [replacedTile], isEviction: false)
+    }
+    bytesCount += tile.bytesCount
+    Self.statistics.withValue { statistics in
+      statistics.missesCount += 1
+      statistics.tilesCount += 1
+      statistics.bytesCount += tile.bytesCount
+    }
+    return image
+  }
+
+  private static func recordRemoval(of tiles: some Sequence<Tile>, isEviction: Bool) {
+    var tilesCount = 0
+    var bytesCount = 0
+    for tile in tiles {
+      tilesCount += 1
+      bytesCount += tile.bytesCount
+    }
+    statistics.withValue { [tilesCount, bytesCount] statistics in
+      statistics.tilesCount -= tilesCount
+      statistics.bytesCount -= bytesCount
+      if isEviction {
+        statistics.evictionsCount += tilesCount
+      }
+    }
+  }
+}
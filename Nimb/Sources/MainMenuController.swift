@@ -250,10 +250,31 @@ final class MainMenuController: NSObject, Rendering {
     store.dispatch(Actions.ToggleStoreActionsLogging())
   }
 
+  @objc private func handleMeasureSoftwareRenderer() {
+    let panel = NSOpenPanel()
+    panel.message = "Choose a recorded msgpack stream of Neovim redraw notifications"
+    guard panel.runModal() == .OK, let url = panel.url else {
+      return
+    }
+    let font = state.font
+    Task.detached(priority: .userInitiated) {
+      do {
+        let benchmark = try SoftwareGridRenderer.measure(
+          redrawStream: Data(contentsOf: url),
+          font: font
+        )
+        logger.info("Software renderer: \(benchmark.framesPerSecond) frames per second, differing from CoreGraphics in \(benchmark.coreGraphicsDifference.differingPixelsFraction) of pixels, \(String(customDumping: benchmark))")
+      } catch {
+        logger.error("Software renderer benchmark error: \(error)")
+      }
+    }
+  }
+
   @objc private func handleLogState() {
     Task {
       var dump = ""
       customDump(self.state, to: &dump, maxDepth: 2)
+      customDump(RowTiles.statistics.value, to: &dump, name: "row tiles")
 
       do {
         let log = try await lastLogEntries()
@@ -421,8 +442,16 @@ extension MainMenuController: NSMenuDelegate {
       )
       toggleStoreActionsLoggingMenuItem.target = self
 
+      let measureSoftwareRendererMenuItem = NSMenuItem(
+        title: "Measure software renderer with recorded redraws...",
+        action: #selector(handleMeasureSoftwareRenderer),
+        keyEquivalent: ""
+      )
+      measureSoftwareRendererMenuItem.target = self
+
       menu.items = [
         logStateMenuItem,
+        measureSoftwareRendererMenuItem,
         NSMenuItem.separator(),
         toggleUIEventsLoggingMenuItem,
         toggleMessagePackInspector,
@@ -7,4 +7,17 @@ public protocol Channel: Sendable {
 
   var dataBatches: S { get }
   func write(_ data: Data) throws
+  func write(_ output: VectorPacker.Output) throws
+}
+
+public extension Channel {
+  func write(_ output: VectorPacker.Output) throws {
+    try write(output.data)
+  }
+}
+
+/// Channel that also exposes the file handle its incoming bytes arrive on,
+/// so they can be read straight into the unpacker buffer instead of going through `dataBatches`.
+public protocol DirectReadingChannel: Channel {
+  var readingFileHandle: FileHandle { get }
 }
@@ -93,6 +93,13 @@ public enum Message: Sendable, Hashable {
 
       self.init(id: id, result: result)
     }
+
+    init(id: Int, error: ValueView, result: ValueView) {
+      self.init(
+        id: id,
+        result: error.isNil ? .success(Value(result)) : .failure(Value(error))
+      )
+    }
   }
 
   @PublicInit
@@ -144,4 +151,87 @@ public enum Message: Sendable, Hashable {
       throw Failure("Unknown raw message type value \(arrayValue[0])")
     }
   }
+
+  public init(view: ValueView) throws {
+    try self.init(View(view))
+  }
+
+  public init(_ view: View) {
+    switch view {
+    case let .request(id, method, parameters):
+      self = .request(
+        .init(
+          id: id,
+          method: method,
+          parameters: parameters.map { Value($0) }
+        )
+      )
+
+    case let .response(id, error, result):
+      self = .response(
+        .init(id: id, error: error, result: result)
+      )
+
+    case let .notification(method, parameters):
+      self = .notification(
+        .init(
+          method: method,
+          parameters: parameters.map { Value($0) }
+        )
+      )
+    }
+  }
+}
+
+public extension Message {
+  /// Borrowed counterpart of `Message` which keeps parameters and results as `ValueView`s,
+  /// so typed decoders can read them without building an intermediate `Value` tree.
+  enum View {
+    case request(id: Int, method: String, parameters: ValueView.Elements)
+    case response(id: Int, error: ValueView, result: ValueView)
+    case notification(method: String, parameters: ValueView.Elements)
+
+    public init(_ view: ValueView) throws {
+      guard let arrayView = view.array, !arrayView.isEmpty else {
+        throw Failure("Invalid message raw value \(Value(view))")
+      }
+      guard let rawMessageType = arrayView[0].integer else {
+        throw Failure("Unknown raw message type value \(Value(arrayView[0]))")
+      }
+      switch rawMessageType {
+      case Request.rawMessageType:
+        guard
+          arrayView.count == 4,
+          let id = arrayView[1].integer,
+          let method = arrayView[2].string,
+          let parameters = arrayView[3].array
+        else {
+          throw Failure("Invalid request raw array value \(Value(view))")
+        }
+        self = .request(id: id, method: method, parameters: parameters)
+
+      case Response.rawMessageType:
+        guard
+          arrayView.count == 4,
+          let id = arrayView[1].integer
+        else {
+          throw Failure("Invalid response raw array value \(Value(view))")
+        }
+        self = .response(id: id, error: arrayView[2], result: arrayView[3])
+
+      case Notification.rawMessageType:
+        guard
+          arrayView.count == 3,
+          let method = arrayView[1].string,
+          let parameters = arrayView[2].array
+        else {
+          throw Failure("Invalid notification raw array value \(Value(view))")
+        }
+        self = .notification(method: method, parameters: parameters)
+
+      default:
+        throw Failure("Unknown raw message type value \(Value(arrayView[0]))")
+      }
+    }
+  }
 }
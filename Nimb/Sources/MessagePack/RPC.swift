@@ -10,20 +10,84 @@ import Foundation
 import Queue
 
 public final class RPC<Target: Channel>: Sendable {
-  public let notifications: AsyncThrowingStream<[Message.Notification], any Error>
+  /// Counters of direct reads, only updated when `Target` is a `DirectReadingChannel`.
+  public var readStatistics: Unpacker.ReadStatistics {
+    readStatisticsStorage.value
+  }
+
+  /// Time spent unpacking and decoding each chunk read from `target`.
+  public var decodeTimings: StageTimings {
+    decodeTimingsStorage.value
+  }
 
   private let target: Target
+  private let readReserveSize: Int
   private let storage = LockIsolated<Storage>(.init())
-  private let packer = LockIsolated<Packer>(.init())
+  /// Separate from `storage`, so encoding a request never blocks the reader delivering responses.
+  private let packer = LockIsolated(VectorPacker())
+  private let readStatisticsStorage = LockIsolated<Unpacker.ReadStatistics>(.init())
+  private let decodeTimingsStorage = LockIsolated<StageTimings>(.init())
   private let queue = AsyncQueue()
 
-  public init(_ target: Target) {
+  public init(
+    _ target: Target,
+    readReserveSize: Int = Int(MSGPACK_UNPACKER_RESERVE_SIZE)
+  ) {
     self.target = target
+    self.readReserveSize = readReserveSize
+  }
+
+  /// Starts reading `target` and yields notification batches, see `readNotifications(decodingWith:onBatch:onFinish:)`.
+  ///
+  /// Every call starts a new reader, so call it at most once per channel and keep the returned stream.
+  public func notifications<Notification: Sendable>(
+    decodingWith decode: @escaping @Sendable (
+      _ method: String,
+      _ parameters: ValueView.Elements
+    ) throws -> Notification?
+  )
+    -> AsyncThrowingStream<[Notification], any Error>
+  {
+    AsyncThrowingStream<[Notification], any Error> { continuation in
+      let stopReading = readNotifications(
+        decodingWith: decode,
+        onBatch: { continuation.yield($0) },
+        onFinish: { continuation.finish(throwing: $0) }
+      )
+      continuation.onTermination = { _ in
+        stopReading()
+      }
+    }
+  }
 
-    notifications = AsyncThrowingStream<[Message.Notification], any Error> { [target, storage] continuation in
-      Task {
-        var notifications = [Message.Notification]()
+  /// Starts reading `target` and decodes every notification with `decode` while its
+  /// parameters are still borrowed from the unpacker zone.
+  ///
+  /// For a `DirectReadingChannel` decoding and `onBatch` run on the channel reading thread, so a blocking `onBatch`
+  /// throttles reading of the pipe. Returning `nil` from `decode` drops the notification. Only one reader should be
+  /// started per channel. Returns a closure that stops reading.
+  @discardableResult
+  public func readNotifications<Notification: Sendable>(
+    decodingWith decode: @escaping @Sendable (
+      _ method: String,
+      _ parameters: ValueView.Elements
+    ) throws -> Notification?,
+    onBatch: @escaping @Sendable ([Notification]) -> Void,
+    onFinish: @escaping @Sendable ((any Error)?) -> Void
+  )
+    -> @Sendable () -> Void
+  {
+    if let directReadingTarget = target as? any DirectReadingChannel {
+      return readNotificationsDirectly(
+        from: directReadingTarget.readingFileHandle,
+        decodingWith: decode,
+        onBatch: onBatch,
+        onFinish: onFinish
+      )
+    }
 
+    let task = Task { [target, storage, decodeTimingsStorage] in
+      do {
         let unpacker = Unpacker()
 
         for try await data in target.dataBatches {
@@ -31,54 +95,173 @@ public final class RPC<Target: Channel>: Sendable {
             break
           }
 
-          let messages = try unpacker.unpack(data)
-            .map { try Message(value: $0) }
+          var notifications = [Notification]()
+          let duration = try ContinuousClock().measure {
+            notifications = try unpacker.unpack(data) { views in
+              try Self.handle(views, storage: storage, decodingWith: decode)
+            }
+          }
+          decodeTimingsStorage.withValue { $0.record(busy: duration) }
 
-          for message in messages {
-            switch message {
-            case let .request(request):
-              logger.warning("Unexpected msgpack request received: \(String(customDumping: request))")
+          if !notifications.isEmpty {
+            onBatch(notifications)
+          }
+        }
 
-            case let .response(response):
-              storage.withValue {
-                $0.responseReceived(response, forRequestWithID: response.id)
-              }
+        onFinish(nil)
+      } catch {
+        onFinish(error)
+      }
+    }
+    return { task.cancel() }
+  }
 
-            case let .notification(notification):
-              notifications.append(notification)
-            }
+  /// Reads from `fileHandle` with `read(2)` directly into the unpacker buffer on every readability callback.
+  private func readNotificationsDirectly<Notification: Sendable>(
+    from fileHandle: FileHandle,
+    decodingWith decode: @escaping @Sendable (
+      _ method: String,
+      _ parameters: ValueView.Elements
+    ) throws -> Notification?,
+    onBatch: @escaping @Sendable ([Notification]) -> Void,
+    onFinish: @escaping @Sendable ((any Error)?) -> Void
+  )
+    -> @Sendable () -> Void
+  {
+    let unpacker = LockIsolated<Unpacker>(.init())
+    unpacker.withValue { [readReserveSize] in $0.readReserveSize = readReserveSize }
+
+    fileHandle.readabilityHandler = { [storage, readStatisticsStorage, decodeTimingsStorage] fileHandle in
+      do {
+        let notifications = try unpacker.withValue { unpacker -> [Notification]? in
+          guard try unpacker.read(from: fileHandle.fileDescriptor) > 0 else {
+            return nil
           }
+          readStatisticsStorage.setValue(unpacker.readStatistics)
 
-          if !notifications.isEmpty {
-            continuation.yield(notifications)
-            notifications.removeAll(keepingCapacity: true)
+          let start = ContinuousClock.now
+          defer {
+            let duration = start.duration(to: .now)
+            decodeTimingsStorage.withValue { $0.record(busy: duration) }
+          }
+          return try unpacker.unpackBuffered { views in
+            try Self.handle(views, storage: storage, decodingWith: decode)
           }
         }
 
-        continuation.finish()
+        guard let notifications else {
+          fileHandle.readabilityHandler = nil
+          onFinish(nil)
+          return
+        }
+
+        if !notifications.isEmpty {
+          onBatch(notifications)
+        }
+      } catch {
+        fileHandle.readabilityHandler = nil
+        onFinish(error)
       }
     }
+
+    return {
+      fileHandle.readabilityHandler = nil
+    }
   }
 
+  private static func handle<Notification>(
+    _ views: [ValueView],
+    storage: LockIsolated<Storage>,
+    decodingWith decode: (
+      _ method: String,
+      _ parameters: ValueView.Elements
+    ) throws -> Notification?
+  ) throws
+    -> [Notification]
+  {
+    var notifications = [Notification]()
+
+    for view in views {
+      let message = try Message.View(view)
+
+      switch message {
+      case .request:
+        logger.warning("Unexpected msgpack request received: \(String(customDumping: Message(message)))")
+
+      case let .response(id, error, result):
+        let response = Message.Response(id: id, error: error, result: result)
+        storage.withValue {
+          $0.responseReceived(response, forRequestWithID: id)
+        }
+
+      case let .notification(method, parameters):
+        if let notification = try decode(method, parameters) {
+          notifications.append(notification)
+        }
+      }
+    }
+
+    return notifications
+  }
+
+  /// Number of `call`s still waiting for a response.
+  public var inFlightRequestsCount: Int {
+    storage.withValue { $0.inFlightRequestsCount }
+  }
+
+  /// Round-trip latencies of answered `call`s keyed by method.
+  public var requestLatencies: [String: RequestLatency] {
+    storage.withValue { $0.latencies }
+  }
+
+  /// Sends a request and waits for its response.
+  ///
+  /// The request slot is reserved, the request packed and the continuation registered synchronously
+  /// on the caller. If `timeout` passes or the calling task is cancelled first, the slot is released
+  /// and a failure is returned, a late response is then ignored.
   @discardableResult
   public func call(
     method: String,
-    withParameters parameters: [Value]
+    withParameters parameters: [Value],
+    timeout: Duration? = nil
   ) async
   -> Message.Response.Result {
-    await withUnsafeContinuation { continuation in
-      Task {
-        let request = Message.Request(
-          id: storage.withValue {
-            $0.announceRequest {
-              continuation.resume(returning: $0.result)
-            }
-          },
-          method: method,
-          parameters: parameters
-        )
-        send(request: request)
+    guard let id = storage.withValue({ $0.reserveRequest(method: method) }) else {
+      return .failure("Too many concurrent msgpack requests")
+    }
+
+    if let timeout {
+      let (seconds, attoseconds) = timeout.components
+      DispatchQueue.global().asyncAfter(
+        deadline: .now() + .nanoseconds(Int(seconds) * 1_000_000_000 + Int(attoseconds / 1_000_000_000))
+      ) { [storage] in
+        storage.withValue {
+          $0.failRequest(withID: id, reason: .timedOut)
+        }
+      }
+    }
+
+    let output = packer.withValue {
+      $0.packRequest(id: id, method: method, parameters: parameters)
+    }
+
+    return await withTaskCancellationHandler {
+      await withUnsafeContinuation { continuation in
+        let isRegistered = storage.withValue {
+          $0.register(continuation, forRequestWithID: id)
+        }
+        if isRegistered {
+          try? target.write(output)
+        }
       }
+    } onCancel: {
+      cancelRequest(withID: id)
+    }
+  }
+
+  public func cancelRequest(withID id: Int) {
+    storage.withValue {
+      $0.failRequest(withID: id, reason: .cancelled)
     }
   }
 
@@ -86,86 +269,179 @@ public final class RPC<Target: Channel>: Sendable {
     method: String,
     withParameters parameters: [Value]
   ) {
-    send(
-      request: .init(
-        id: storage.withValue { $0.announceRequest() },
-        method: method,
-        parameters: parameters
-      )
-    )
+    let id = storage.withValue { $0.announceUntrackedRequest() }
+    let output = packer.withValue {
+      $0.packRequest(id: id, method: method, parameters: parameters)
+    }
+
+    try? target.write(output)
   }
 
   public func fastCallsTransaction(with calls: some Sequence<(
     method: String,
     parameters: [Value]
   )> & Sendable) {
-    let messages = storage.withValue { storage in
+    let requests = storage.withValue { storage in
       calls.map { call in
-        Message.Request(
-          id: storage.announceRequest(),
+        (
+          id: storage.announceUntrackedRequest(),
           method: call.method,
           parameters: call.parameters
         )
       }
     }
+    let output = packer.withValue { $0.packRequests(requests) }
 
-    let data = packer.withValue { packer in
-      var data = Data()
-
-      for message in messages {
-        data.append(
-          packer.pack(
-            message.makeValue()
-          )
-        )
-      }
+    try? target.write(output)
+  }
 
-      return data
+  public func send(request: Message.Request) {
+    let output = packer.withValue {
+      $0.packRequest(
+        id: request.id,
+        method: request.method,
+        parameters: request.parameters
+      )
     }
 
-    try? target.write(data)
+    try? target.write(output)
   }
+}
 
-  public func send(request: Message.Request) {
-    let data = packer.withValue {
-      $0.pack(request.makeValue())
-    }
+public struct RequestLatency: Sendable {
+  public var count: Int = 0
+  public var total: Duration = .zero
+  public var maximum: Duration = .zero
 
-    try? target.write(data)
+  public var average: Duration {
+    count == 0 ? .zero : total / count
   }
 }
 
+/// Fixed capacity table of pending requests. Requests are packed outside of it, so the lock
+/// the reader takes for every response only covers bookkeeping.
+///
+/// Request IDs are `generation << slotBits | slot`. A slot's generation is bumped whenever it is released,
+/// so responses to timed out or cancelled requests never reach the next request reusing that slot.
+/// IDs stay within the UInt32 range msgpack-rpc uses for message IDs.
 private final class Storage {
-  private let maximumConcurrentRequests = Int.max
-  private var currentRequests = IntKeyedDictionary<@Sendable (Message.Response) -> Void>()
-  private var announcedRequestsCount = 0
+  typealias Continuation = UnsafeContinuation<Message.Response.Result, Never>
 
-  func announceRequest(
-    _ handler: (@Sendable (Message.Response) -> Void)? =
-      nil
-  )
-    -> Int
-  {
-    let id = announcedRequestsCount
+  enum FailureReason: String {
+    case timedOut = "msgpack request timed out"
+    case cancelled = "msgpack request cancelled"
+  }
+
+  private struct Slot {
+    var generation = 0
+    var isReserved = false
+    var continuation: Continuation?
+    var method = ""
+    var sentAt: ContinuousClock.Instant?
+    /// Why the request of the previous generation failed, reported by `register` when it comes too late.
+    var previousFailureReason: FailureReason?
+  }
+
+  private static let slotBits = 10
+  private static let capacity = 1 << slotBits
+  private static let generationMask = (1 << (32 - slotBits)) - 1
+  /// Never reserved, fire-and-forget requests only advance its generation.
+  private static let untrackedSlot = capacity - 1
+
+  private(set) var inFlightRequestsCount = 0
+  private(set) var latencies = [String: RequestLatency]()
+  private var slots = [Slot](repeating: .init(), count: capacity)
+  private var freeSlots = Array((0 ..< untrackedSlot).reversed())
+
+  /// Returns `nil` when all slots are taken.
+  func reserveRequest(method: String) -> Int? {
+    guard let slot = freeSlots.popLast() else {
+      return nil
+    }
+    slots[slot].isReserved = true
+    slots[slot].method = method
+    inFlightRequestsCount += 1
 
-    (announcedRequestsCount, _) = (announcedRequestsCount + 1)
-      .remainderReportingOverflow(dividingBy: maximumConcurrentRequests)
+    return slots[slot].generation << Self.slotBits | slot
+  }
+
+  /// Registers `continuation` for a reserved request that is about to be written.
+  ///
+  /// Returns `false` and resumes `continuation` right away if the request was already released by a timeout or cancellation.
+  func register(_ continuation: Continuation, forRequestWithID id: Int) -> Bool {
+    let (slot, generation) = Self.slotAndGeneration(id)
 
-    if let handler {
-      currentRequests[id] = handler
+    guard slots[slot].isReserved, slots[slot].generation == generation else {
+      let reason =
+        if slots[slot].generation == (generation + 1) & Self.generationMask {
+          slots[slot].previousFailureReason ?? .cancelled
+        } else {
+          FailureReason.cancelled
+        }
+      continuation.resume(returning: .failure(.string(reason.rawValue)))
+      return false
     }
+    slots[slot].continuation = continuation
+    slots[slot].sentAt = .now
 
-    return id
+    return true
+  }
+
+  func announceUntrackedRequest() -> Int {
+    let generation = slots[Self.untrackedSlot].generation
+    slots[Self.untrackedSlot].generation = (generation + 1) & Self.generationMask
+
+    return generation << Self.slotBits | Self.untrackedSlot
   }
 
   func responseReceived(
     _ response: Message.Response,
     forRequestWithID id: Int
   ) {
-    guard let handler = currentRequests[id] else {
+    guard let slot = releaseRequest(withID: id) else {
       return
     }
-    currentRequests[id] = nil
-    handler(response)
+
+    if let sentAt = slot.sentAt {
+      let latency = sentAt.duration(to: .now)
+      var methodLatency = latencies[slot.method, default: .init()]
+      methodLatency.count += 1
+      methodLatency.total += latency
+      methodLatency.maximum = max(methodLatency.maximum, latency)
+      latencies[slot.method] = methodLatency
+    }
+    slot.continuation?.resume(returning: response.result)
+  }
+
+  func failRequest(withID id: Int, reason: FailureReason) {
+    releaseRequest(withID: id, failureReason: reason)?.continuation?.resume(
+      returning: .failure(.string(reason.rawValue))
+    )
+  }
+
+  private static func slotAndGeneration(_ id: Int) -> (slot: Int, generation: Int) {
+    (id & (capacity - 1), id >> slotBits)
+  }
+
+  private func releaseRequest(withID id: Int, failureReason: FailureReason? = nil) -> Slot? {
+    let (slot, generation) = Self.slotAndGeneration(id)
+
+    guard
+      slot != Self.untrackedSlot,
+      slots[slot].isReserved,
+      slots[slot].generation == generation
+    else {
+      return nil
+    }
+
+    let released = slots[slot]
+    slots[slot] = .init(
+      generation: (generation + 1) & Self.generationMask,
+      previousFailureReason: failureReason
+    )
+    freeSlots.append(slot)
+    inFlightRequestsCount -= 1
+
+    return released
   }
 }
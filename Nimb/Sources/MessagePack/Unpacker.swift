@@ -3,20 +3,83 @@
 import Foundation
 
 public class Unpacker {
+  public struct ReadStatistics: Sendable {
+    public var bytesRead: Int = 0
+    public var chunksCount: Int = 0
+    public var largestChunkSize: Int = 0
+    public var reserveSize: Int = 0
+
+    public var averageChunkSize: Int {
+      chunksCount == 0 ? 0 : bytesRead / chunksCount
+    }
+  }
+
+  /// Free buffer space ensured before each `read(from:)`, which is the largest chunk a single read can take.
+  public var readReserveSize = Int(MSGPACK_UNPACKER_RESERVE_SIZE)
+
+  public struct ZoneStatistics: Sendable {
+    /// Zones created with `msgpack_zone_new`, steady state decoding should not increase it.
+    public var allocatedZonesCount: Int = 0
+    /// Most zones borrowed by the messages of a single unpacked batch.
+    public var borrowedZonesHighWaterMark: Int = 0
+    /// Largest number of bytes a single message used in a zone that did not need another chunk.
+    public var messageBytesHighWaterMark: Int = 0
+    /// Messages that did not fit into the first zone chunk and made the zone allocate another one.
+    public var expandedZonesCount: Int = 0
+    /// Zones freed instead of pooled, because the pool was full or their chunk size is no longer current.
+    public var freedZonesCount: Int = 0
+    public var chunkSize: Int = 0
+  }
+
+  public private(set) var readStatistics = ReadStatistics()
+  public private(set) var zoneStatistics = ZoneStatistics()
+
   private var mpac = msgpack_unpacker()
-  private var unpacked = msgpack_unpacked()
+  private var zonePool = [UnsafeMutablePointer<msgpack_zone>]()
+  private var chunkSize = Unpacker.minimumChunkSize
+  private let maximumChunkSize: Int
+  private let maximumPooledZonesCount: Int
+  /// Largest number of bytes a single message used since the chunk size last changed.
+  private var recentMessageBytesHighWaterMark = 0
+  private var batchesSinceChunkSizeChangeCount = 0
+
+  private static let minimumChunkSize = Int(MSGPACK_ZONE_CHUNK_SIZE)
+  /// Batches to observe before halving a chunk size that recent messages used at most a quarter of.
+  private static let chunkSizeDecayBatchesCount = 256
 
-  public init() {
+  /// Zones released by unpacked messages are cleared and reused instead of being freed,
+  /// up to `maximumPooledZonesCount` of them. Their chunk size grows until a typical message fits
+  /// into a single chunk, and shrinks back once messages stay much smaller for a while.
+  public init(maximumChunkSize: Int = 1024 * 1024, maximumPooledZonesCount: Int = 4) {
+    self.maximumChunkSize = maximumChunkSize
+    self.maximumPooledZonesCount = maximumPooledZonesCount
     msgpack_unpacker_init(&mpac, Int(MSGPACK_UNPACKER_INIT_BUFFER_SIZE))
-    msgpack_unpacked_init(&unpacked)
+    zoneStatistics.chunkSize = chunkSize
   }
 
   deinit {
-    msgpack_unpacked_destroy(&unpacked)
+    for zone in zonePool {
+      msgpack_zone_free(zone)
+    }
     msgpack_unpacker_destroy(&mpac)
   }
 
   public func unpack(_ data: Data) throws -> [Value] {
+    try unpack(data) { views in
+      views.map { Value($0) }
+    }
+  }
+
+  /// Unpacks every complete message buffered so far and passes borrowed views of them to `body`.
+  ///
+  /// Zones of the unpacked messages are kept alive until `body` returns, so the views
+  /// must not escape it.
+  public func unpack<Result>(
+    _ data: Data,
+    _ body: (_ views: [ValueView]) throws -> Result
+  ) throws
+    -> Result
+  {
     if msgpack_unpacker_buffer_capacity(&mpac) < data.count {
       msgpack_unpacker_reserve_buffer(&mpac, data.count)
     }
@@ -30,27 +93,160 @@ public class Unpacker {
     }
     msgpack_unpacker_buffer_consumed(&mpac, data.count)
 
-    var accumulator = [Value]()
+    return try unpackBuffered(body)
+  }
+
+  /// Reads bytes available on `fileDescriptor` straight into the unpacker buffer.
+  ///
+  /// Returns the number of bytes read, `0` means end of file.
+  public func read(from fileDescriptor: Int32) throws -> Int {
+    if msgpack_unpacker_buffer_capacity(&mpac) < readReserveSize {
+      guard msgpack_unpacker_reserve_buffer(&mpac, readReserveSize) else {
+        throw Failure("msgpack_unpacker_reserve_buffer failed", readReserveSize)
+      }
+    }
+
+    var count: Int
+    repeat {
+      count = Darwin.read(
+        fileDescriptor,
+        msgpack_unpacker_buffer(&mpac),
+        msgpack_unpacker_buffer_capacity(&mpac)
+      )
+    } while count < 0 && errno == EINTR
+
+    guard count >= 0 else {
+      throw Failure("read failed", String(cString: strerror(errno)))
+    }
+    msgpack_unpacker_buffer_consumed(&mpac, count)
+
+    readStatistics.bytesRead += count
+    readStatistics.chunksCount += 1
+    readStatistics.largestChunkSize = max(readStatistics.largestChunkSize, count)
+    readStatistics.reserveSize = readReserveSize
+
+    return count
+  }
+
+  /// Unpacks every complete message already in the buffer, see `unpack(_:_:)`.
+  public func unpackBuffered<Result>(
+    _ body: (_ views: [ValueView]) throws -> Result
+  ) throws
+    -> Result
+  {
+    var views = [ValueView]()
+    var zones = [UnsafeMutablePointer<msgpack_zone>]()
+    defer {
+      for zone in zones {
+        recycle(zone)
+      }
+    }
+
     while true {
-      let result = msgpack_unpacker_next(&mpac, &unpacked)
+      let firstChunk = mpac.z.pointee.chunk_list.head
 
-      switch result {
-      case MSGPACK_UNPACK_EXTRA_BYTES,
-           MSGPACK_UNPACK_SUCCESS:
-        accumulator.append(.init(unpacked.data))
+      let result = msgpack_unpacker_execute(&mpac)
+      if result == 0 {
+        break
+      }
+
+      guard result > 0 else {
+        throw switch result {
+        case MSGPACK_UNPACK_PARSE_ERROR.rawValue:
+          Failure("MSGPACK_UNPACK_PARSE_ERROR")
 
-      case MSGPACK_UNPACK_CONTINUE:
-        return accumulator
+        case MSGPACK_UNPACK_NOMEM_ERROR.rawValue:
+          Failure("MSGPACK_UNPACK_NOMEM_ERROR")
 
-      case MSGPACK_UNPACK_PARSE_ERROR:
-        throw Failure("MSGPACK_UNPACK_PARSE_ERROR")
+        default:
+          Failure("Invalid msgpack unpacking result \(result)")
+        }
+      }
 
-      case MSGPACK_UNPACK_NOMEM_ERROR:
+      // Same as msgpack_unpacker_release_zone, but the replacement zone comes from the pool.
+      guard msgpack_unpacker_flush_zone(&mpac) else {
         throw Failure("MSGPACK_UNPACK_NOMEM_ERROR")
+      }
+      let zone = mpac.z!
+      mpac.z = try makeZone()
+      zones.append(zone)
 
-      default:
-        throw Failure("Invalid msgpack unpacking result \(result)")
+      views.append(.init(msgpack_unpacker_data(&mpac)))
+      msgpack_unpacker_reset(&mpac)
+
+      if zone.pointee.chunk_list.head == firstChunk {
+        let messageBytesCount = zone.pointee.chunk_size - zone.pointee.chunk_list.free
+        zoneStatistics.messageBytesHighWaterMark = max(
+          zoneStatistics.messageBytesHighWaterMark,
+          messageBytesCount
+        )
+        recentMessageBytesHighWaterMark = max(recentMessageBytesHighWaterMark, messageBytesCount)
+      } else {
+        zoneStatistics.expandedZonesCount += 1
+        setChunkSize(min(chunkSize * 2, maximumChunkSize))
       }
     }
+
+    zoneStatistics.borrowedZonesHighWaterMark = max(
+      zoneStatistics.borrowedZonesHighWaterMark,
+      zones.count
+    )
+
+    if !zones.isEmpty {
+      decayChunkSizeIfUnused()
+    }
+
+    return try body(views)
+  }
+
+  private func decayChunkSizeIfUnused() {
+    batchesSinceChunkSizeChangeCount += 1
+    guard batchesSinceChunkSizeChangeCount >= Self.chunkSizeDecayBatchesCount else {
+      return
+    }
+    if chunkSize > Self.minimumChunkSize, recentMessageBytesHighWaterMark * 4 <= chunkSize {
+      setChunkSize(max(chunkSize / 2, Self.minimumChunkSize))
+    } else {
+      batchesSinceChunkSizeChangeCount = 0
+      recentMessageBytesHighWaterMark = 0
+    }
+  }
+
+  /// Pooled zones have the previous chunk size, so they are freed right away.
+  private func setChunkSize(_ chunkSize: Int) {
+    for zone in zonePool {
+      msgpack_zone_free(zone)
+    }
+    zoneStatistics.freedZonesCount += zonePool.count
+    zonePool.removeAll(keepingCapacity: true)
+
+    self.chunkSize = chunkSize
+    zoneStatistics.chunkSize = chunkSize
+    batchesSinceChunkSizeChangeCount = 0
+    recentMessageBytesHighWaterMark = 0
+  }
+
+  private func makeZone() throws -> UnsafeMutablePointer<msgpack_zone> {
+    if let zone = zonePool.popLast() {
+      return zone
+    }
+
+    guard let zone = msgpack_zone_new(chunkSize) else {
+      throw Failure("MSGPACK_UNPACK_NOMEM_ERROR")
+    }
+    zoneStatistics.allocatedZonesCount += 1
+    return zone
+  }
+
+  /// Runs the zone finalizers, which release the unpacker buffer references, and puts it back into the pool
+  /// if its chunks have the current adaptive chunk size and the pool is not full.
+  private func recycle(_ zone: UnsafeMutablePointer<msgpack_zone>) {
+    guard zone.pointee.chunk_size == chunkSize, zonePool.count < maximumPooledZonesCount else {
+      msgpack_zone_free(zone)
+      zoneStatistics.freedZonesCount += 1
+      return
+    }
+    msgpack_zone_clear(zone)
+    zonePool.append(zone)
   }
 }
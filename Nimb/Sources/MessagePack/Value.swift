@@ -37,6 +37,12 @@ public enum Value: Sendable, Hashable, ExpressibleByStringLiteral,
   init(
     _ object: msgpack_object
   ) {
+    self.init(ValueView(object))
+  }
+
+  public init(_ view: ValueView) {
+    let object = view.object
+
     switch object.type {
     case MSGPACK_OBJECT_NEGATIVE_INTEGER,
          MSGPACK_OBJECT_POSITIVE_INTEGER: self = .integer(Int(object.via.i64))
@@ -46,64 +52,37 @@ public enum Value: Sendable, Hashable, ExpressibleByStringLiteral,
 
     case MSGPACK_OBJECT_BOOLEAN: self = .boolean(object.via.boolean)
 
-    case MSGPACK_OBJECT_STR:
-      let str = object.via.str
-      let size = Int(str.size)
-
-      let string = String(
-        unsafeUninitializedCapacity: size,
-        initializingUTF8With: { buffer in
-          memcpy(
-            buffer.baseAddress!,
-            str.ptr,
-            size
-          )
-          return size
-        }
-      )
-      self = .string(string)
+    case MSGPACK_OBJECT_STR: self = .string(view.string!)
 
     case MSGPACK_OBJECT_ARRAY:
-      let cArray = object.via.array
+      let array = view.array!
 
-      let count = Int(cArray.size)
       var accumulator = [Value]()
+      accumulator.reserveCapacity(array.count)
 
-      for index in 0 ..< count {
-        accumulator.append(Value(cArray.ptr.advanced(by: index).pointee))
+      for element in array {
+        accumulator.append(Value(element))
       }
 
       self = .array(accumulator)
 
     case MSGPACK_OBJECT_MAP:
-      let map = object.via.map
+      let map = view.dictionary!
 
-      let count = Int(map.size)
-      var dictionary = [Value: Value](minimumCapacity: count)
+      var dictionary = [Value: Value](minimumCapacity: map.count)
 
-      for index in 0 ..< count {
-        let kv = map.ptr.advanced(by: index).pointee
-
-        let key = Value(kv.key)
-        let value = Value(kv.val)
-        dictionary[key] = value
+      for (key, value) in map {
+        dictionary[Value(key)] = Value(value)
       }
 
       self = .dictionary(dictionary)
 
-    case MSGPACK_OBJECT_BIN:
-      let bin = object.via.bin
-
-      let data = Data(bytes: UnsafeRawPointer(bin.ptr), count: Int(bin.size))
-      self = .binary(data)
+    case MSGPACK_OBJECT_BIN: self = .binary(view.binary!)
 
     case MSGPACK_OBJECT_EXT:
-      let ext = object.via.ext
+      let (type, data) = view.ext!
 
-      self = .ext(
-        type: ext.type,
-        data: .init(bytes: UnsafeRawPointer(ext.ptr), count: Int(ext.size))
-      )
+      self = .ext(type: type, data: data)
 
     case MSGPACK_OBJECT_NIL: self = .nil
 
@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: MIT
+
+import Foundation
+
+/// Borrowed view of a decoded msgpack object.
+///
+/// Reads directly from the `msgpack_object` graph owned by the unpacker zone,
+/// so it is only valid inside the `Unpacker.unpack(_:_:)` closure that produced it.
+/// Use `Value(_:)` to materialize anything that has to outlive the batch.
+public struct ValueView {
+  public struct Elements: RandomAccessCollection {
+    private let pointer: UnsafeMutablePointer<msgpack_object>?
+
+    public let count: Int
+
+    public var startIndex: Int {
+      0
+    }
+
+    public var endIndex: Int {
+      count
+    }
+
+    init(_ array: msgpack_object_array) {
+      pointer = array.ptr
+      count = Int(array.size)
+    }
+
+    public subscript(position: Int) -> ValueView {
+      .init(pointer![position])
+    }
+  }
+
+  public struct Entries: RandomAccessCollection {
+    public typealias Element = (key: ValueView, value: ValueView)
+
+    private let pointer: UnsafeMutablePointer<msgpack_object_kv>?
+
+    public let count: Int
+
+    public var startIndex: Int {
+      0
+    }
+
+    public var endIndex: Int {
+      count
+    }
+
+    init(_ map: msgpack_object_map) {
+      pointer = map.ptr
+      count = Int(map.size)
+    }
+
+    public subscript(position: Int) -> Element {
+      let kv = pointer![position]
+      return (ValueView(kv.key), ValueView(kv.val))
+    }
+
+    public subscript(key: String) -> ValueView? {
+      for index in 0 ..< count {
+        let kv = pointer![index]
+        if ValueView(kv.key).isString(key) {
+          return .init(kv.val)
+        }
+      }
+      return nil
+    }
+  }
+
+  public let object: msgpack_object
+
+  public var isNil: Bool {
+    object.type == MSGPACK_OBJECT_NIL
+  }
+
+  public var integer: Int? {
+    switch object.type {
+    case MSGPACK_OBJECT_NEGATIVE_INTEGER,
+         MSGPACK_OBJECT_POSITIVE_INTEGER:
+      Int(object.via.i64)
+
+    default:
+      nil
+    }
+  }
+
+  public var float: Double? {
+    switch object.type {
+    case MSGPACK_OBJECT_FLOAT,
+         MSGPACK_OBJECT_FLOAT32:
+      object.via.f64
+
+    default:
+      nil
+    }
+  }
+
+  public var boolean: Bool? {
+    object.type == MSGPACK_OBJECT_BOOLEAN ? object.via.boolean : nil
+  }
+
+  public var string: String? {
+    guard object.type == MSGPACK_OBJECT_STR else {
+      return nil
+    }
+    let str = object.via.str
+    let size = Int(str.size)
+
+    return String(
+      unsafeUninitializedCapacity: size,
+      initializingUTF8With: { buffer in
+        memcpy(
+          buffer.baseAddress!,
+          str.ptr,
+          size
+        )
+        return size
+      }
+    )
+  }
+
+  public var array: Elements? {
+    object.type == MSGPACK_OBJECT_ARRAY ? .init(object.via.array) : nil
+  }
+
+  public var dictionary: Entries? {
+    object.type == MSGPACK_OBJECT_MAP ? .init(object.via.map) : nil
+  }
+
+  public var binary: Data? {
+    guard object.type == MSGPACK_OBJECT_BIN else {
+      return nil
+    }
+    let bin = object.via.bin
+    return .init(bytes: UnsafeRawPointer(bin.ptr), count: Int(bin.size))
+  }
+
+  public var ext: (type: Int8, data: Data)? {
+    guard object.type == MSGPACK_OBJECT_EXT else {
+      return nil
+    }
+    let ext = object.via.ext
+    return (
+      ext.type,
+      .init(bytes: UnsafeRawPointer(ext.ptr), count: Int(ext.size))
+    )
+  }
+
+  public init(_ object: msgpack_object) {
+    self.object = object
+  }
+
+  /// Calls `body` with the raw UTF-8 bytes of a string object without copying them.
+  public func withUnsafeStringBytes<Result>(
+    _ body: (UnsafeRawBufferPointer) throws -> Result
+  ) rethrows
+    -> Result?
+  {
+    guard object.type == MSGPACK_OBJECT_STR else {
+      return nil
+    }
+    let str = object.via.str
+    return try body(.init(start: str.ptr, count: Int(str.size)))
+  }
+
+  public func isString(_ string: String) -> Bool {
+    var string = string
+    return string.withUTF8 { expected in
+      withUnsafeStringBytes { bytes in
+        bytes.elementsEqual(UnsafeRawBufferPointer(expected))
+      } ?? false
+    }
+  }
+}
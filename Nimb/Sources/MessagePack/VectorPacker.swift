@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: MIT
+
+import ConcurrencyExtras
+import Foundation
+
+/// Packer that writes headers and small bodies into reusable `msgpack_vrefbuffer` chunks
+/// and references large string and binary bodies in place.
+///
+/// Output is a list of `iovec`s meant to be written with a single `writev`.
+public final class VectorPacker {
+  public final class Output: @unchecked Sendable {
+    /// Total number of bytes in all vectors.
+    public let count: Int
+    public let copiedBytesCount: Int
+    public let referencedBytesCount: Int
+
+    public var data: Data {
+      withVectors { vectors in
+        var data = Data(capacity: count)
+        for vector in vectors {
+          data.append(
+            vector.iov_base.assumingMemoryBound(to: UInt8.self),
+            count: vector.iov_len
+          )
+        }
+        return data
+      }
+    }
+
+    private let buffer: VectorBuffer
+    private let retainedStrings: [String]
+    private let retainedData: [Data]
+    private let pool: LockIsolated<[VectorBuffer]>
+
+    fileprivate init(
+      buffer: VectorBuffer,
+      retainedStrings: [String],
+      retainedData: [Data],
+      referencedBytesCount: Int,
+      pool: LockIsolated<[VectorBuffer]>
+    ) {
+      self.buffer = buffer
+      self.retainedStrings = retainedStrings
+      self.retainedData = retainedData
+      self.referencedBytesCount = referencedBytesCount
+      self.pool = pool
+
+      count = buffer.vectors.reduce(0) { $0 + $1.iov_len }
+      copiedBytesCount = count - referencedBytesCount
+    }
+
+    deinit {
+      msgpack_vrefbuffer_clear(buffer.pointer)
+      pool.withValue { [buffer] buffers in
+        if buffers.count < VectorPacker.maximumPooledBuffersCount {
+          buffers.append(buffer)
+        }
+      }
+    }
+
+    /// Vectors stay valid for as long as `self` is alive.
+    public func withVectors<Result>(
+      _ body: (UnsafeBufferPointer<iovec>) throws -> Result
+    ) rethrows
+      -> Result
+    {
+      try body(buffer.vectors)
+    }
+  }
+
+  fileprivate static let maximumPooledBuffersCount = 8
+
+  private let referenceThreshold: Int
+  private let chunkSize: Int
+  private let pool = LockIsolated<[VectorBuffer]>([])
+  private var pk = msgpack_packer()
+  private var retainedStrings = [String]()
+  private var retainedData = [Data]()
+  private var referencedBytesCount = 0
+
+  /// Bodies of at least `referenceThreshold` bytes are referenced instead of copied.
+  public init(
+    referenceThreshold: Int = 1024,
+    chunkSize: Int = Int(MSGPACK_VREFBUFFER_CHUNK_SIZE)
+  ) {
+    self.referenceThreshold = referenceThreshold
+    self.chunkSize = chunkSize
+  }
+
+  public func pack(_ value: Value) -> Output {
+    packing { process(value) }
+  }
+
+  /// Packs a msgpack-rpc request without wrapping it into an intermediate `Value` array.
+  public func packRequest(
+    id: Int,
+    method: String,
+    parameters: [Value]
+  )
+    -> Output
+  {
+    packing {
+      processRequest(id: id, method: method, parameters: parameters)
+    }
+  }
+
+  /// Packs consecutive msgpack-rpc requests into a single output.
+  public func packRequests(
+    _ requests: some Sequence<(id: Int, method: String, parameters: [Value])>
+  )
+    -> Output
+  {
+    packing {
+      for request in requests {
+        processRequest(
+          id: request.id,
+          method: request.method,
+          parameters: request.parameters
+        )
+      }
+    }
+  }
+
+  private func packing(_ body: () -> Void) -> Output {
+    let buffer = pool.withValue { $0.popLast() }
+      ?? VectorBuffer(referenceThreshold: referenceThreshold, chunkSize: chunkSize)
+
+    msgpack_packer_init(&pk, buffer.pointer, msgpack_vrefbuffer_write)
+    body()
+
+    defer {
+      retainedStrings.removeAll(keepingCapacity: true)
+      retainedData.removeAll(keepingCapacity: true)
+      referencedBytesCount = 0
+    }
+    return .init(
+      buffer: buffer,
+      retainedStrings: retainedStrings,
+      retainedData: retainedData,
+      referencedBytesCount: referencedBytesCount,
+      pool: pool
+    )
+  }
+
+  private func processRequest(id: Int, method: String, parameters: [Value]) {
+    msgpack_pack_array(&pk, 4)
+    msgpack_pack_int64(&pk, Int64(Message.Request.rawMessageType))
+    msgpack_pack_int64(&pk, Int64(id))
+    process(.string(method))
+    msgpack_pack_array(&pk, parameters.count)
+    for parameter in parameters {
+      process(parameter)
+    }
+  }
+
+  private func process(_ value: Value) {
+    switch value {
+    case let .boolean(boolean):
+      if boolean {
+        msgpack_pack_true(&pk)
+
+      } else {
+        msgpack_pack_false(&pk)
+      }
+
+    case let .integer(integer):
+      msgpack_pack_int64(&pk, Int64(integer))
+
+    case var .string(string):
+      // Native contiguous UTF-8 storage does not move while the string is retained unmutated,
+      // which is what lets msgpack_vrefbuffer keep a reference to it.
+      string.makeContiguousUTF8()
+      string.withUTF8 { buffer in
+        _ = msgpack_pack_str_with_body(
+          &self.pk,
+          buffer.baseAddress,
+          buffer.count
+        )
+      }
+      if string.utf8.count >= referenceThreshold {
+        retainedStrings.append(string)
+        referencedBytesCount += string.utf8.count
+      }
+
+    case let .float(double): msgpack_pack_float(&pk, Float(double))
+
+    case let .dictionary(dictionary):
+      msgpack_pack_map(&pk, dictionary.count)
+
+      for (key, value) in dictionary {
+        process(key)
+        process(value)
+      }
+
+    case let .array(array):
+      msgpack_pack_array(&pk, array.count)
+
+      for element in array {
+        process(element)
+      }
+
+    case let .ext(type, data):
+      data.withUnsafeBytes { buffer in
+        _ = msgpack_pack_ext_with_body(
+          &self.pk,
+          buffer.baseAddress,
+          buffer.count,
+          type
+        )
+      }
+      retain(data)
+
+    case let .binary(data):
+      data.withUnsafeBytes { buffer in
+        _ = msgpack_pack_bin_with_body(
+          &self.pk,
+          buffer.baseAddress,
+          buffer.count
+        )
+      }
+      retain(data)
+
+    case .nil: msgpack_pack_nil(&pk)
+    }
+  }
+
+  private func retain(_ data: Data) {
+    if data.count >= referenceThreshold {
+      retainedData.append(data)
+      referencedBytesCount += data.count
+    }
+  }
+}
+
+private final class VectorBuffer: @unchecked Sendable {
+  let pointer: UnsafeMutablePointer<msgpack_vrefbuffer>
+
+  var vectors: UnsafeBufferPointer<iovec> {
+    .init(
+      start: msgpack_vrefbuffer_vec(pointer),
+      count: msgpack_vrefbuffer_veclen(pointer)
+    )
+  }
+
+  init(referenceThreshold: Int, chunkSize: Int) {
+    pointer = msgpack_vrefbuffer_new(referenceThreshold, chunkSize)!
+  }
+
+  deinit {
+    msgpack_vrefbuffer_free(pointer)
+  }
+}
@@ -1,43 +1,60 @@
 // SPDX-License-Identifier: MIT
 
 public final class API<Target: Channel>: Sendable {
-  public let neovimNotifications: AsyncThrowingStream<[NeovimNotification], any Error>
+  /// Time spent unpacking and decoding neovim output.
+  public var decodeTimings: StageTimings {
+    rpc.decodeTimings
+  }
 
   let rpc: RPC<Target>
 
   public init(_ rpc: RPC<Target>) {
     self.rpc = rpc
+  }
+
+  /// Pushes decoded notification batches to `onBatch` from the reading thread, see `RPC.readNotifications`.
+  @discardableResult
+  public func readNeovimNotifications(
+    onBatch: @escaping @Sendable ([NeovimNotification]) -> Void,
+    onFinish: @escaping @Sendable ((any Error)?) -> Void
+  )
+    -> @Sendable () -> Void
+  {
+    rpc.readNotifications(
+      decodingWith: Self.decodeNeovimNotification,
+      onBatch: onBatch,
+      onFinish: onFinish
+    )
+  }
 
-    neovimNotifications = rpc.notifications
-      .map { notifications -> [NeovimNotification] in
-        try notifications.compactMap { notification in
-          switch notification.method {
-          case "redraw":
-            let uiEvents =
-              try [UIEvent](
-                rawRedrawNotificationParameters: notification
-                  .parameters
-              )
-            return .redraw(uiEvents)
+  @Sendable
+  private static func decodeNeovimNotification(
+    method: String,
+    parameters: ValueView.Elements
+  ) throws
+    -> NeovimNotification?
+  {
+    switch method {
+    case "redraw":
+      let uiEvents = try [UIEvent](
+        redrawNotificationParameters: parameters
+      )
+      return .redraw(uiEvents)
 
-          case "nvim_error_event":
-            let nvimErrorEvent = try NeovimErrorEvent(
-              parameters: notification
-                .parameters
-            )
-            return .nvimErrorEvent(nvimErrorEvent)
+    case "nvim_error_event":
+      let nvimErrorEvent = try NeovimErrorEvent(
+        parameters: parameters.map { Value($0) }
+      )
+      return .nvimErrorEvent(nvimErrorEvent)
 
-          case "nimb_notify":
-            let notifies = try notification.parameters
-              .map { try NimbNotify($0) }
-            return .nimbNotify(notifies)
+    case "nimb_notify":
+      let notifies = try parameters
+        .map { try NimbNotify(Value($0)) }
+      return .nimbNotify(notifies)
 
-          default:
-            return nil
-          }
-        }
-      }
-      .eraseToThrowingStream()
+    default:
+      return nil
+    }
   }
 
   @discardableResult
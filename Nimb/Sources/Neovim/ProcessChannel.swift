@@ -1,26 +1,166 @@
 // SPDX-License-Identifier: MIT
 
+import ConcurrencyExtras
 import Foundation
-import Queue
 
-public struct ProcessChannel: Channel {
-  private let standardOutput = Pipe()
-  private let standardInput = Pipe()
-  private let writingAsyncQueue = AsyncQueue()
+public struct ProcessChannel: DirectReadingChannel {
+  private let standardOutput: Pipe
+  private let standardInput: Pipe
+  private let writer: FrameWriter
 
   public var dataBatches: AsyncStream<Data> {
     standardOutput.fileHandleForReading.dataBatches
   }
 
-  public init(_ process: Foundation.Process) {
+  public var readingFileHandle: FileHandle {
+    standardOutput.fileHandleForReading
+  }
+
+  /// Frames written within `maximumWriteLatency` of the previous flush are coalesced into a single `writev`,
+  /// the first frame after an idle period is flushed right away.
+  public init(
+    _ process: Foundation.Process,
+    maximumWriteLatency: Duration = .milliseconds(2)
+  ) {
+    standardOutput = Pipe()
+    standardInput = Pipe()
+    writer = .init(
+      fileHandle: standardInput.fileHandleForWriting,
+      maximumLatency: maximumWriteLatency
+    )
+
     process.standardOutput = standardOutput
     process.standardInput = standardInput
   }
 
   public func write(_ data: Data) throws {
-    writingAsyncQueue.addOperation {
-      try standardInput.fileHandleForWriting
-        .write(contentsOf: data)
+    writer.enqueue(.data(data))
+  }
+
+  public func write(_ output: VectorPacker.Output) throws {
+    writer.enqueue(.output(output))
+  }
+}
+
+/// `scratch` and `vectors` are only accessed on `queue`.
+private final class FrameWriter: @unchecked Sendable {
+  enum Frame: Sendable {
+    case data(Data)
+    case output(VectorPacker.Output)
+  }
+
+  private struct Pending {
+    var frames = [Frame]()
+    var isFlushScheduled = false
+    var lastFlushTime: ContinuousClock.Instant?
+  }
+
+  private let fileHandle: FileHandle
+  private let maximumLatency: Duration
+  private let queue = DispatchQueue(label: "ProcessChannel.writing", qos: .userInteractive)
+  private let pending = LockIsolated<Pending>(.init())
+  private var scratch = UnsafeMutableRawBufferPointer.allocate(byteCount: 4096, alignment: 1)
+  private var vectors = [iovec]()
+
+  init(fileHandle: FileHandle, maximumLatency: Duration) {
+    self.fileHandle = fileHandle
+    self.maximumLatency = maximumLatency
+  }
+
+  deinit {
+    scratch.deallocate()
+  }
+
+  func enqueue(_ frame: Frame) {
+    let flushDelay = pending.withValue { [maximumLatency] pending -> Duration? in
+      pending.frames.append(frame)
+
+      guard !pending.isFlushScheduled else {
+        return nil
+      }
+      pending.isFlushScheduled = true
+
+      guard let lastFlushTime = pending.lastFlushTime else {
+        return .zero
+      }
+      return max(.zero, maximumLatency - lastFlushTime.duration(to: .now))
+    }
+
+    guard let flushDelay else {
+      return
+    }
+
+    if flushDelay == .zero {
+      queue.async { self.flush() }
+
+    } else {
+      let (seconds, attoseconds) = flushDelay.components
+      queue.asyncAfter(
+        deadline: .now() + .nanoseconds(Int(seconds) * 1_000_000_000 + Int(attoseconds / 1_000_000_000))
+      ) {
+        self.flush()
+      }
+    }
+  }
+
+  private func flush() {
+    let frames = pending.withValue { pending in
+      pending.isFlushScheduled = false
+      pending.lastFlushTime = .now
+
+      defer { pending.frames = [] }
+      return pending.frames
+    }
+
+    var dataBytesCount = 0
+    for case let .data(data) in frames {
+      dataBytesCount += data.count
     }
+    if scratch.count < dataBytesCount {
+      scratch.deallocate()
+      scratch = .allocate(byteCount: dataBytesCount * 2, alignment: 1)
+    }
+
+    // Small Data values are stored inline, so their bytes are copied into `scratch`
+    // instead of being referenced.
+    vectors.removeAll(keepingCapacity: true)
+    var scratchOffset = 0
+    var isLastVectorInScratch = false
+
+    for frame in frames {
+      switch frame {
+      case let .data(data):
+        guard !data.isEmpty else {
+          continue
+        }
+        let base = scratch.baseAddress! + scratchOffset
+        data.copyBytes(to: base.assumingMemoryBound(to: UInt8.self), count: data.count)
+        scratchOffset += data.count
+
+        if isLastVectorInScratch {
+          vectors[vectors.count - 1].iov_len += data.count
+
+        } else {
+          vectors.append(.init(iov_base: base, iov_len: data.count))
+          isLastVectorInScratch = true
+        }
+
+      case let .output(output):
+        output.withVectors { outputVectors in
+          vectors.append(contentsOf: outputVectors)
+        }
+        isLastVectorInScratch = false
+      }
+    }
+
+    do {
+      try vectors.withUnsafeBufferPointer { vectors in
+        try fileHandle.write(vectors: vectors)
+      }
+    } catch {
+      logger.error("ProcessChannel write failed: \(String(describing: error))")
+    }
+
+    withExtendedLifetime(frames) {}
   }
 }
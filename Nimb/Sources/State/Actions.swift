@@ -40,7 +40,7 @@ public enum Actions {
 
     public func apply(to state: inout State, handleError: @Sendable (Error) -> Void) -> State.Updates {
       state.font = value
-      state.flushDrawRuns()
+      state.updateCursorDrawRuns()
       return .init(needFlush: true, isFontUpdated: true)
     }
   }
@@ -1,8 +1,8 @@
 // SPDX-License-Identifier: MIT
 
+import AppKit
 import Collections
 
-@PublicInit
 public struct Appearance: Sendable {
   public enum ObservedHighlightName: String, CaseIterable, Sendable {
     case normal = "Normal"
@@ -21,15 +21,134 @@ public struct Appearance: Sendable {
     case tabLineSel = "TabLineSel"
   }
 
-  public var highlights: IntKeyedDictionary<Highlight> = [:]
+  /// Highlight attributes resolved for drawing: reverse, blend and default colors are applied
+  /// and `CGColor`s are created once.
+  public struct ResolvedStyle: @unchecked Sendable {
+    public var foregroundColor: Color
+    public var backgroundColor: Color
+    public var specialColor: Color
+    public var foregroundCGColor: CGColor
+    public var backgroundCGColor: CGColor
+    public var specialCGColor: CGColor
+    public var isBold: Bool
+    public var isItalic: Bool
+    public var isReverse: Bool
+    public var decorations: Highlight.Decorations
+
+    init(
+      highlight: Highlight?,
+      defaultForegroundColor: Color,
+      defaultBackgroundColor: Color,
+      defaultSpecialColor: Color
+    ) {
+      if let highlight {
+        foregroundColor = highlight.isReverse ?
+          highlight.backgroundColor ?? defaultBackgroundColor :
+          highlight.foregroundColor ?? defaultForegroundColor
+        backgroundColor = (
+          highlight.isReverse ?
+            highlight.foregroundColor ?? defaultForegroundColor :
+            highlight.backgroundColor ?? defaultBackgroundColor
+        )
+        .with(alpha: highlight.backgroundColorAlpha)
+        specialColor = highlight.specialColor ??
+          (highlight.isReverse ? defaultBackgroundColor : defaultForegroundColor)
+        isBold = highlight.isBold
+        isItalic = highlight.isItalic
+        isReverse = highlight.isReverse
+        decorations = highlight.decorations
+
+      } else {
+        foregroundColor = defaultForegroundColor
+        backgroundColor = defaultBackgroundColor
+        specialColor = defaultSpecialColor
+        isBold = false
+        isItalic = false
+        isReverse = false
+        decorations = .init()
+      }
+
+      foregroundCGColor = foregroundColor.cg
+      backgroundCGColor = backgroundColor.cg
+      specialCGColor = specialColor.cg
+    }
+
+    public func appKitFont(_ font: Font) -> NSFont {
+      font.appKit(isBold: isBold, isItalic: isItalic)
+    }
+  }
+
+  public private(set) var highlights: IntKeyedDictionary<Highlight> = [:]
   public var observedHighlights: TreeDictionary<
     ObservedHighlightName,
     (id: Int?, kind: String?)
   > =
     [:]
-  public var defaultForegroundColor: Color = .black
-  public var defaultBackgroundColor: Color = .black
-  public var defaultSpecialColor: Color = .black
+  public private(set) var defaultForegroundColor: Color = .black
+  public private(set) var defaultBackgroundColor: Color = .black
+  public private(set) var defaultSpecialColor: Color = .black
+  /// Resolved styles indexed by highlight ID, IDs without a highlight hold `defaultStyle`.
+  public private(set) var styles: [ResolvedStyle] = []
+  public private(set) var defaultStyle: ResolvedStyle = .init(
+    highlight: nil,
+    defaultForegroundColor: .black,
+    defaultBackgroundColor: .black,
+    defaultSpecialColor: .black
+  )
+
+  /// Resolved styles are always derived from highlights and default colors, never passed in.
+  public init(
+    highlights: IntKeyedDictionary<Highlight> = [:],
+    observedHighlights: TreeDictionary<ObservedHighlightName, (id: Int?, kind: String?)> = [:],
+    defaultForegroundColor: Color = .black,
+    defaultBackgroundColor: Color = .black,
+    defaultSpecialColor: Color = .black
+  ) {
+    self.observedHighlights = observedHighlights
+    setDefaultColors(
+      foreground: defaultForegroundColor,
+      background: defaultBackgroundColor,
+      special: defaultSpecialColor
+    )
+    for highlight in highlights.values {
+      setHighlight(highlight)
+    }
+  }
+
+  /// Highlight ID zero always uses default colors.
+  public func style(for highlightID: Highlight.ID) -> ResolvedStyle {
+    highlightID > 0 && highlightID < styles.count ? styles[highlightID] : defaultStyle
+  }
+
+  public mutating func setHighlight(_ highlight: Highlight) {
+    highlights[highlight.id] = highlight
+
+    guard highlight.id > 0 else {
+      return
+    }
+    if highlight.id >= styles.count {
+      styles.append(
+        contentsOf: repeatElement(defaultStyle, count: highlight.id - styles.count + 1)
+      )
+    }
+    styles[highlight.id] = resolvedStyle(for: highlight)
+  }
+
+  /// Every resolved style depends on default colors, so all of them are rebuilt.
+  public mutating func setDefaultColors(
+    foreground: Color,
+    background: Color,
+    special: Color
+  ) {
+    defaultForegroundColor = foreground
+    defaultBackgroundColor = background
+    defaultSpecialColor = special
+
+    defaultStyle = resolvedStyle(for: nil)
+    for id in styles.indices {
+      styles[id] = resolvedStyle(for: highlights[id])
+    }
+  }
 
   public func observedHighlight(_ name: ObservedHighlightName) -> Highlight? {
     guard let (id, _) = observedHighlights[name], let id else {
@@ -97,68 +216,41 @@ public struct Appearance: Sendable {
   }
 
   public func isItalic(for highlightID: Highlight.ID) -> Bool {
-    guard highlightID != .zero, let highlight = highlights[highlightID] else {
-      return false
-    }
-
-    return highlight.isItalic
+    style(for: highlightID).isItalic
   }
 
   public func isBold(for highlightID: Highlight.ID) -> Bool {
-    guard highlightID != .zero, let highlight = highlights[highlightID] else {
-      return false
-    }
-
-    return highlight.isBold
+    style(for: highlightID).isBold
   }
 
   public func isReverse(for highlightID: Highlight.ID) -> Bool {
-    guard highlightID != .zero, let highlight = highlights[highlightID] else {
-      return false
-    }
-
-    return highlight.isReverse
+    style(for: highlightID).isReverse
   }
 
   public func decorations(for highlightID: Highlight.ID) -> Highlight
     .Decorations
   {
-    guard highlightID != .zero, let highlight = highlights[highlightID] else {
-      return .init()
-    }
-
-    return highlight.decorations
+    style(for: highlightID).decorations
   }
 
   public func foregroundColor(for highlightID: Highlight.ID) -> Color {
-    guard highlightID != .zero, let highlight = highlights[highlightID] else {
-      return defaultForegroundColor
-    }
-
-    return highlight.isReverse ?
-      highlight.backgroundColor ?? defaultBackgroundColor :
-      highlight.foregroundColor ?? defaultForegroundColor
+    style(for: highlightID).foregroundColor
   }
 
   public func backgroundColor(for highlightID: Highlight.ID) -> Color {
-    guard highlightID != .zero, let highlight = highlights[highlightID] else {
-      return defaultBackgroundColor
-    }
-
-    let color = highlight.isReverse ?
-      highlight.foregroundColor ?? defaultForegroundColor :
-      highlight.backgroundColor ?? defaultBackgroundColor
-
-    return color.with(alpha: highlight.backgroundColorAlpha)
+    style(for: highlightID).backgroundColor
   }
 
   public func specialColor(for highlightID: Highlight.ID) -> Color {
-    guard highlightID != .zero, let highlight = highlights[highlightID] else {
-      return defaultSpecialColor
-    }
+    style(for: highlightID).specialColor
+  }
 
-    return highlight
-      .specialColor ??
-      (highlight.isReverse ? defaultBackgroundColor : defaultForegroundColor)
+  private func resolvedStyle(for highlight: Highlight?) -> ResolvedStyle {
+    .init(
+      highlight: highlight,
+      defaultForegroundColor: defaultForegroundColor,
+      defaultBackgroundColor: defaultBackgroundColor,
+      defaultSpecialColor: defaultSpecialColor
+    )
   }
 }
@@ -75,24 +75,16 @@ public extension Actions {
       }
 
       func apply(update: Grid.Update, toGridWithID gridID: Grid.ID) {
-        let font = state.font
-        let appearance = state.appearance
         let outerGrid = state.outerGrid
         Overture.update(&state.grids[gridID]) { grid in
           if grid == nil {
-            grid = Grid(
-              id: gridID,
-              size: outerGrid!.size,
-              font: font,
-              appearance: appearance
-            )
+            grid = Grid(id: gridID, size: outerGrid!.size)
             grid!.isHidden = true
           }
         }
         let result = state.grids[gridID]!.apply(
           update: update,
-          font: font,
-          appearance: appearance
+          font: state.font
         )
         if let result {
           Overture.update(&updates.gridUpdates[gridID]) { gridUpdate in
@@ -198,13 +190,12 @@ public extension Actions {
 
         case let .defaultColorsSet(batch):
           for params in batch {
-            state.appearance
-              .defaultForegroundColor = .init(rgb: params.rgbFg)
-            state.appearance
-              .defaultBackgroundColor = .init(rgb: params.rgbBg)
-            state.appearance.defaultSpecialColor = .init(rgb: params.rgbSp)
+            state.appearance.setDefaultColors(
+              foreground: .init(rgb: params.rgbFg),
+              background: .init(rgb: params.rgbBg),
+              special: .init(rgb: params.rgbSp)
+            )
           }
-          state.flushDrawRuns()
           appearanceUpdated()
 
         case let .gridResize(batch):
@@ -220,23 +211,16 @@ public extension Actions {
             if
               state.grids[params.grid]?.size != size
             {
-              let font = state.font
-              let appearance = state.appearance
               update(&state.grids[params.grid]) { grid in
                 if grid == nil {
                   let cells = TwoDimensionalArray(
                     size: size,
                     repeatingElement: Cell.whitespace
                   )
-                  let layout = GridLayout(cells: cells)
                   grid = .init(
                     id: params.grid,
-                    layout: layout,
-                    drawRuns: .init(
-                      layout: layout,
-                      font: font,
-                      appearance: appearance
-                    ),
+                    layout: GridLayout(cells: cells),
+                    cursorDrawRun: nil,
                     associatedWindow: nil,
                     isHidden: false
                   )
@@ -799,7 +783,13 @@ public extension Actions {
               }
             }
 
-            state.appearance.highlights[params.id] = highlight
+            if
+              let previousHighlight = state.appearance.highlights[params.id],
+              previousHighlight != highlight
+            {
+              updates.redefinedHighlightIDs.insert(params.id)
+            }
+            state.appearance.setHighlight(highlight)
 
             for rawInfoItem in params.info {
               if
@@ -829,76 +819,22 @@ public extension Actions {
             let gridID = params.grid
             let row = params.row
             let colStart = params.colStart
-            let data = params.data
-
-            var cells = [Cell]()
-            var highlightID = 0
-
-            for value in data {
-              guard
-                case let .array(arrayValue) = value,
-                !arrayValue.isEmpty,
-                case let .string(text) = arrayValue[0]
-              else {
-                handleError(Failure("invalid grid line cell value", value))
-                break
-              }
-
-              var repeatCount = 1
-
-              if arrayValue.count > 1 {
-                guard
-                  case let .integer(newHighlightID) = arrayValue[1]
-                else {
-                  handleError(Failure(
-                    "invalid grid line cell highlight value",
-                    arrayValue[1]
-                  ))
-                  break
-                }
-
-                highlightID = newHighlightID
-
-                if arrayValue.count > 2 {
-                  guard
-                    case let .integer(newRepeatCount) = arrayValue[2]
-                  else {
-                    handleError(Failure(
-                      "invalid grid line cell repeat count value",
-                      arrayValue[2]
-                    ))
-                    break
-                  }
-
-                  repeatCount = newRepeatCount
-                }
-              }
-
-              if text.count > 1 {
-                handleError(Failure("grid line cell text has more than one character", text))
-              } else if text.isEmpty, !cells.isEmpty {
-                cells[cells.count - 1].isDoubleWidth = true
-              }
-
-              let cell = Cell(
-                character: text.first,
-                isDoubleWidth: false,
-                highlightID: highlightID
-              )
-              for _ in 0 ..< repeatCount {
-                cells.append(cell)
-              }
+            let cells = params.data.cells
+            for invalidCell in params.data.invalidCells {
+              handleError(Failure(invalidCell.reason, invalidCell.value))
             }
 
-            let dirtyRectangle = state
+            let (dirtyRectangle, isCoalesced) = state
               .grids[gridID]!
-              .applyLineUpdate(
+              .writeLine(
                 originColumn: colStart,
                 cells: cells,
-                row: row,
-                font: state.font,
-                appearance: state.appearance
+                row: row
               )
+            state.lineUpdatesStatistics.linesCount += 1
+            if isCoalesced {
+              state.lineUpdatesStatistics.coalescedLinesCount += 1
+            }
 
             update(&updates.gridUpdates[gridID]) { updates in
               switch updates {
@@ -0,0 +1,187 @@
+// SPDX-License-Identifier: MIT
+
+import Foundation
+
+/// Grid cell packed into 8 bytes.
+///
+/// Text made of a single Unicode scalar is stored inline as its scalar value, longer grapheme clusters
+/// are interned in `ClusterTable` and stored as an index, so equal cells always have equal bits
+/// and equality, hashing and run detection never touch string storage.
+public struct Cell: Sendable, Hashable {
+  public static let whitespace = Self(
+    text: " ",
+    isDoubleWidth: false,
+    highlightID: .zero
+  )
+
+  /// Highlight IDs a packed cell can hold, decoders reject others instead of truncating them.
+  public static let highlightIDRange = 0 ... Int(highlightIDMask)
+
+  private static let highlightIDMask: UInt32 = 0x0FFF_FFFF
+  private static let isDoubleWidthFlag: UInt32 = 1 << 31
+  private static let isClusterFlag: UInt32 = 1 << 30
+  private static let hasNoTextFlag: UInt32 = 1 << 29
+  private static let isWhitespaceFlag: UInt32 = 1 << 28
+
+  /// Unicode scalar value, or `ClusterTable` index when `isClusterFlag` is set.
+  private var content: UInt32
+  /// Highlight ID in the low 28 bits and flags in the high 4 bits.
+  private var attributes: UInt32
+
+  /// `nil` for the cell following a double width character.
+  public var text: String? {
+    if attributes & Self.hasNoTextFlag != 0 {
+      nil
+    } else if attributes & Self.isClusterFlag != 0 {
+      ClusterTable.shared.text(at: content)
+    } else {
+      Unicode.Scalar(content).map { String($0) }
+    }
+  }
+
+  public var hasText: Bool {
+    attributes & Self.hasNoTextFlag == 0
+  }
+
+  /// Text of more than one Unicode scalar, interned in `ClusterTable`.
+  public var isCluster: Bool {
+    attributes & Self.isClusterFlag != 0
+  }
+
+  public var isWhitespace: Bool {
+    attributes & Self.isWhitespaceFlag != 0
+  }
+
+  public var isDoubleWidth: Bool {
+    get {
+      attributes & Self.isDoubleWidthFlag != 0
+    }
+    set {
+      if newValue {
+        attributes |= Self.isDoubleWidthFlag
+      } else {
+        attributes &= ~Self.isDoubleWidthFlag
+      }
+    }
+  }
+
+  public var highlightID: Highlight.ID {
+    get {
+      Int(attributes & Self.highlightIDMask)
+    }
+    set {
+      precondition(
+        Self.highlightIDRange.contains(newValue),
+        "Highlight ID \(newValue) does not fit into 28 bits of a packed cell"
+      )
+      attributes = (attributes & ~Self.highlightIDMask) | UInt32(newValue)
+    }
+  }
+
+  public init(
+    text: String?,
+    isDoubleWidth: Bool = false,
+    highlightID: Highlight.ID
+  ) {
+    content = 0
+    attributes = 0
+
+    if let text, !text.isEmpty {
+      let scalars = text.unicodeScalars
+      if scalars.count == 1, let scalar = scalars.first {
+        content = scalar.value
+        if scalar.properties.isWhitespace {
+          attributes |= Self.isWhitespaceFlag
+        }
+
+      } else {
+        content = ClusterTable.shared.index(for: text)
+        attributes |= Self.isClusterFlag
+        if text.allSatisfy(\.isWhitespace) {
+          attributes |= Self.isWhitespaceFlag
+        }
+      }
+
+    } else {
+      attributes |= Self.hasNoTextFlag
+    }
+
+    self.isDoubleWidth = isDoubleWidth
+    self.highlightID = highlightID
+  }
+
+  /// Builds a cell from raw UTF-8 text, ASCII text does not create a `String` at all.
+  public init(
+    utf8 bytes: UnsafeRawBufferPointer,
+    highlightID: Highlight.ID
+  ) {
+    if bytes.count == 1, bytes[0] < 0x80 {
+      let byte = bytes[0]
+      content = UInt32(byte)
+      attributes = byte == 0x20 || (0x09 ... 0x0D).contains(byte) ? Self.isWhitespaceFlag : 0
+      self.highlightID = highlightID
+
+    } else {
+      self.init(
+        text: String(decoding: bytes, as: UTF8.self),
+        highlightID: highlightID
+      )
+    }
+  }
+}
+
+/// Texts of cells that consist of more than one Unicode scalar.
+///
+/// Entries are never removed: the number of distinct clusters a session displays is small,
+/// and stable indices are what makes packed cells comparable.
+///
+/// Texts are stored in fixed size segments that never move, so `text(at:)` reads without locking
+/// and parallel shaping threads do not contend. Only interning takes the lock. An index is published
+/// by `index(for:)` after its text was stored, and every cell carrying it reaches other threads
+/// through synchronization that orders that store before any read.
+final class ClusterTable: @unchecked Sendable {
+  private static let segmentBits = 10
+  private static let segmentCapacity = 1 << segmentBits
+  private static let maximumSegmentsCount = 4096
+
+  static let shared = ClusterTable()
+
+  private let segments: UnsafeMutablePointer<UnsafeMutablePointer<String>?>
+  private let lock = NSLock()
+  /// Only accessed under `lock`.
+  private var indices = [String: UInt32]()
+  /// Only accessed under `lock`.
+  private var count = 0
+
+  private init() {
+    segments = .allocate(capacity: Self.maximumSegmentsCount)
+    segments.initialize(repeating: nil, count: Self.maximumSegmentsCount)
+  }
+
+  func index(for text: String) -> UInt32 {
+    lock.withLock {
+      if let index = indices[text] {
+        return index
+      }
+      precondition(
+        count < Self.maximumSegmentsCount * Self.segmentCapacity,
+        "Cluster table is full"
+      )
+      let segmentIndex = count >> Self.segmentBits
+      if segments[segmentIndex] == nil {
+        segments[segmentIndex] = .allocate(capacity: Self.segmentCapacity)
+      }
+      (segments[segmentIndex]! + (count & (Self.segmentCapacity - 1))).initialize(to: text)
+
+      let index = UInt32(count)
+      indices[text] = index
+      count += 1
+      return index
+    }
+  }
+
+  func text(at index: UInt32) -> String {
+    let index = Int(index)
+    return segments[index >> Self.segmentBits]![index & (Self.segmentCapacity - 1)]
+  }
+}
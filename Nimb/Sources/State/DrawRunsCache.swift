@@ -0,0 +1,220 @@
+// SPDX-License-Identifier: MIT
+
+import AppKit
+
+/// Process-wide cache of shaped draw runs, shared by all grids.
+///
+/// Entries are keyed by the full row part content together with font and traits, so a hit always
+/// matches the content that was shaped. The cache is split into shards, each with its own lock
+/// and least recently used eviction, so parallel shaping threads rarely contend. Size is bounded
+/// by the estimated memory of cached glyph runs rather than by the number of entries.
+public final class DrawRunsCache: Sendable {
+  @PublicInit
+  public struct Key: Hashable, Sendable {
+    public var rowPartContent: RowPartContent
+    public var font: Font
+    public var isBold: Bool
+    public var isItalic: Bool
+  }
+
+  @PublicInit
+  public struct Statistics: Sendable {
+    public var hitsCount: Int = 0
+    public var missesCount: Int = 0
+    public var evictionsCount: Int = 0
+    public var entriesCount: Int = 0
+    public var bytesCount: Int = 0
+
+    mutating func formUnion(_ other: Statistics) {
+      hitsCount += other.hitsCount
+      missesCount += other.missesCount
+      evictionsCount += other.evictionsCount
+      entriesCount += other.entriesCount
+      bytesCount += other.bytesCount
+    }
+  }
+
+  public static let shared = DrawRunsCache()
+
+  private let shards: [Shard]
+
+  public var statistics: Statistics {
+    var statistics = Statistics()
+    for shard in shards {
+      statistics.formUnion(shard.statistics)
+    }
+    return statistics
+  }
+
+  /// `shardsCount` is rounded up to a power of two.
+  public init(
+    shardsCount: Int = 16,
+    maximumBytesCount: Int = 64 * 1024 * 1024
+  ) {
+    var roundedShardsCount = 1
+    while roundedShardsCount < shardsCount {
+      roundedShardsCount <<= 1
+    }
+    shards = (0 ..< roundedShardsCount).map { _ in
+      Shard(maximumBytesCount: maximumBytesCount / roundedShardsCount)
+    }
+  }
+
+  public func drawRun(for key: Key) -> DrawRun? {
+    shard(for: key).drawRun(for: key)
+  }
+
+  public func store(_ drawRun: DrawRun, for key: Key) {
+    shard(for: key).store(drawRun, for: key)
+  }
+
+  private func shard(for key: Key) -> Shard {
+    shards[key.hashValue & (shards.count - 1)]
+  }
+}
+
+/// Entries form a doubly linked list stored in `entries` by index, most recently used first.
+/// Freed indices are reused through `freeIndices`.
+private final class Shard: @unchecked Sendable {
+  private struct Entry {
+    var key: DrawRunsCache.Key
+    var drawRun: DrawRun
+    var bytesCount: Int
+    var previous: Int?
+    var next: Int?
+  }
+
+  private let maximumBytesCount: Int
+  private let lock = NSLock()
+  private var indices = [DrawRunsCache.Key: Int]()
+  private var entries = [Entry?]()
+  private var freeIndices = [Int]()
+  private var head: Int?
+  private var tail: Int?
+  private var _statistics = DrawRunsCache.Statistics()
+
+  var statistics: DrawRunsCache.Statistics {
+    lock.lock()
+    defer { lock.unlock() }
+    return _statistics
+  }
+
+  init(maximumBytesCount: Int) {
+    self.maximumBytesCount = maximumBytesCount
+  }
+
+  func drawRun(for key: DrawRunsCache.Key) -> DrawRun? {
+    lock.lock()
+    defer { lock.unlock() }
+
+    guard let index = indices[key] else {
+      _statistics.missesCount += 1
+      return nil
+    }
+    _statistics.hitsCount += 1
+    moveToFront(index)
+    return entries[index]!.drawRun
+  }
+
+  func store(_ drawRun: DrawRun, for key: DrawRunsCache.Key) {
+    let bytesCount = drawRun.estimatedBytesCount
+
+    lock.lock()
+    defer { lock.unlock() }
+
+    if let index = indices[key] {
+      _statistics.bytesCount += bytesCount - entries[index]!.bytesCount
+      entries[index]!.drawRun = drawRun
+      entries[index]!.bytesCount = bytesCount
+      moveToFront(index)
+
+    } else {
+      let entry = Entry(key: key, drawRun: drawRun, bytesCount: bytesCount, previous: nil, next: head)
+      let index: Int
+      if let freeIndex = freeIndices.popLast() {
+        index = freeIndex
+        entries[index] = entry
+      } else {
+        index = entries.count
+        entries.append(entry)
+      }
+      if let head {
+        entries[head]!.previous = index
+      }
+      head = index
+      if tail == nil {
+        tail = index
+      }
+      indices[key] = index
+      _statistics.entriesCount += 1
+      _statistics.bytesCount += bytesCount
+    }
+
+    while _statistics.bytesCount > maximumBytesCount, let tail, tail != head {
+      evict(tail)
+    }
+  }
+
+  private func moveToFront(_ index: Int) {
+    guard index != head else {
+      return
+    }
+    unlink(index)
+    entries[index]!.previous = nil
+    entries[index]!.next = head
+    if let head {
+      entries[head]!.previous = index
+    }
+    head = index
+    if tail == nil {
+      tail = index
+    }
+  }
+
+  private func unlink(_ index: Int) {
+    let entry = entries[index]!
+    if let previous = entry.previous {
+      entries[previous]!.next = entry.next
+    } else {
+      head = entry.next
+    }
+    if let next = entry.next {
+      entries[next]!.previous = entry.previous
+    } else {
+      tail = entry.previous
+    }
+  }
+
+  private func evict(_ index: Int) {
+    unlink(index)
+    let entry = entries[index]!
+    entries[index] = nil
+    freeIndices.append(index)
+    indices.removeValue(forKey: entry.key)
+
+    _statistics.evictionsCount += 1
+    _statistics.entriesCount -= 1
+    _statistics.bytesCount -= entry.bytesCount
+  }
+}
+
+extension DrawRun {
+  /// Rough memory footprint used for cache accounting.
+  var estimatedBytesCount: Int {
+    let contentBytesCount =
+      switch rowPartContent {
+      case let .cells(cells):
+        cells.reduce(0) { $0 + MemoryLayout<RowPartCell>.stride + $1.text.utf8.count }
+
+      case .whitespace:
+        0
+      }
+    let glyphRunsBytesCount = (glyphRuns ?? []).reduce(0) { bytesCount, glyphRun in
+      bytesCount + MemoryLayout<GlyphRun>.stride
+        + glyphRun.glyphs.count * MemoryLayout<CGGlyph>.stride
+        + glyphRun.positions.count * MemoryLayout<CGPoint>.stride
+        + glyphRun.advances.count * MemoryLayout<CGSize>.stride
+    }
+    return MemoryLayout<DrawRun>.stride + contentBytesCount + glyphRunsBytesCount
+  }
+}
@@ -0,0 +1,211 @@
+// SPDX-License-Identifier: MIT
+
+import AppKit
+import ConcurrencyExtras
+
+/// Glyph IDs of one font variant for the scalars grids display most, used to lay out simple runs
+/// without the typesetter.
+///
+/// A run qualifies when every cell is a single width, single scalar character of a left to right
+/// script without contextual forms, which the font itself renders at the advance of "A". Glyphs
+/// are then placed where CoreText would put them in a monospace line. Runs with combining marks,
+/// joining or reordering scripts like Arabic or Devanagari, characters that need a fallback font
+/// or, in fonts with glyph substitution tables, adjacent ASCII symbols that may form a ligature
+/// are left to `DrawRun.makeShapedGlyphRuns`.
+public final class GlyphTable: @unchecked Sendable {
+  public static let scalarsRange: Range<UInt32> = 0 ..< 0x3000
+
+  /// Blocks inside `scalarsRange` whose letters need neither joining nor reordering.
+  private static let simpleBlocks: [Range<UInt32>] = [
+    // Basic Latin through Armenian.
+    0x0000 ..< 0x0590,
+    // Georgian.
+    0x10A0 ..< 0x1100,
+    // Phonetic Extensions.
+    0x1D00 ..< 0x1DC0,
+    // Latin Extended Additional, Greek Extended, punctuation and symbols.
+    0x1E00 ..< 0x3000,
+  ]
+
+  private let appKitFont: NSFont
+  private let textMatrix: CGAffineTransform
+  private let offset: CGPoint
+  private let advance: CGSize
+  private let hasSubstitutions: Bool
+  /// Indexed by scalar value, zero for scalars that need the typesetter.
+  private let glyphs: [CGGlyph]
+
+  public init(font: Font, isBold: Bool, isItalic: Bool) {
+    // Shaping a reference character yields the font, text matrix and offset the typesetter uses.
+    let referenceGlyphRun = DrawRun.makeShapedGlyphRuns(
+      cells: [.init(text: "A", isDoubleWidth: false)],
+      font: font,
+      appKitFont: font.appKit(isBold: isBold, isItalic: isItalic)
+    )[0]
+    let appKitFont = referenceGlyphRun.appKitFont
+    let advance = referenceGlyphRun.advances[0]
+    self.appKitFont = appKitFont
+    self.advance = advance
+    textMatrix = referenceGlyphRun.textMatrix
+    offset = referenceGlyphRun.positions[0]
+    hasSubstitutions = [kCTFontTableGSUB, kCTFontTableMorx].contains { table in
+      CTFontCopyTable(appKitFont, CTFontTableTag(table), []) != nil
+    }
+
+    let characters = Self.scalarsRange.map { UniChar($0) }
+    var glyphs = [CGGlyph](repeating: 0, count: characters.count)
+    CTFontGetGlyphsForCharacters(appKitFont, characters, &glyphs, characters.count)
+    var advances = [CGSize](repeating: .zero, count: characters.count)
+    CTFontGetAdvancesForGlyphs(appKitFont, .horizontal, glyphs, &advances, glyphs.count)
+    for index in glyphs.indices {
+      let isSimple = Unicode.Scalar(UInt32(index)).map(Self.isSimple(_:)) ?? false
+      if !isSimple || advances[index].width != advance.width {
+        glyphs[index] = 0
+      }
+    }
+    self.glyphs = glyphs
+  }
+
+  /// Returns `nil` when `cells` need the typesetter.
+  public func glyphRun(for cells: [RowPartCell]) -> GlyphRun? {
+    var runGlyphs = [CGGlyph]()
+    runGlyphs.reserveCapacity(cells.count)
+    var isPreviousLigatureCandidate = false
+
+    for cell in cells {
+      guard !cell.isDoubleWidth else {
+        return nil
+      }
+      var scalars = cell.text.unicodeScalars.makeIterator()
+      guard
+        let scalar = scalars.next(), scalars.next() == nil,
+        Self.scalarsRange.contains(scalar.value)
+      else {
+        return nil
+      }
+      let glyph = glyphs[Int(scalar.value)]
+      guard glyph != 0 else {
+        return nil
+      }
+      let isLigatureCandidate = hasSubstitutions && Self.isLigatureCandidate(scalar)
+      if isPreviousLigatureCandidate, isLigatureCandidate {
+        return nil
+      }
+      isPreviousLigatureCandidate = isLigatureCandidate
+      runGlyphs.append(glyph)
+    }
+
+    return .init(
+      appKitFont: appKitFont,
+      textMatrix: textMatrix,
+      glyphs: runGlyphs,
+      positions: runGlyphs.indices.map { index in
+        .init(x: offset.x + Double(index) * advance.width, y: offset.y)
+      },
+      advances: .init(repeating: advance, count: runGlyphs.count)
+    )
+  }
+
+  private static func isSimple(_ scalar: Unicode.Scalar) -> Bool {
+    guard simpleBlocks.contains(where: { $0.contains(scalar.value) }) else {
+      return false
+    }
+    switch scalar.properties.generalCategory {
+    case .nonspacingMark, .spacingMark, .enclosingMark, .control, .format, .surrogate,
+         .privateUse, .unassigned, .lineSeparator, .paragraphSeparator:
+      false
+
+    default:
+      true
+    }
+  }
+
+  /// ASCII punctuation and symbols, sequences of which are what programming fonts ligate.
+  private static func isLigatureCandidate(_ scalar: Unicode.Scalar) -> Bool {
+    scalar.isASCII && scalar.value > 0x20 && scalar.value < 0x7F
+      && !scalar.properties.isAlphabetic && !("0" ... "9").contains(scalar)
+  }
+}
+
+/// Glyph tables by font variant, shared by all grids.
+public final class GlyphTables: Sendable {
+  @PublicInit
+  public struct Key: Hashable, Sendable {
+    public var font: Font
+    public var isBold: Bool
+    public var isItalic: Bool
+  }
+
+  @PublicInit
+  public struct Statistics: Sendable {
+    public var fastPathRunsCount: Int = 0
+    public var shapedRunsCount: Int = 0
+
+    public var fastPathFraction: Double {
+      let runsCount = fastPathRunsCount + shapedRunsCount
+      return runsCount == 0 ? 0 : Double(fastPathRunsCount) / Double(runsCount)
+    }
+
+    public mutating func recordRun(isFastPath: Bool) {
+      if isFastPath {
+        fastPathRunsCount += 1
+      } else {
+        shapedRunsCount += 1
+      }
+    }
+
+    mutating func formUnion(_ other: Statistics) {
+      fastPathRunsCount += other.fastPathRunsCount
+      shapedRunsCount += other.shapedRunsCount
+    }
+  }
+
+  public static let shared = GlyphTables()
+
+  public var statistics: Statistics {
+    _statistics.value
+  }
+
+  /// Builds its table once. Callers that need the same variant wait for it, others only take
+  /// the dictionary lock for the lookup.
+  private final class Entry: @unchecked Sendable {
+    private let lock = NSLock()
+    private var table: GlyphTable?
+
+    func table(building build: () -> GlyphTable) -> GlyphTable {
+      lock.withLock {
+        if let table {
+          return table
+        }
+        let table = build()
+        self.table = table
+        return table
+      }
+    }
+  }
+
+  private let entries = LockIsolated([Key: Entry]())
+  private let _statistics = LockIsolated(Statistics())
+
+  public func table(for key: Key) -> GlyphTable {
+    let entry = entries.withValue { entries in
+      if let entry = entries[key] {
+        return entry
+      }
+      let entry = Entry()
+      entries[key] = entry
+      return entry
+    }
+    return entry.table {
+      GlyphTable(font: key.font, isBold: key.isBold, isItalic: key.isItalic)
+    }
+  }
+
+  /// Adds runs counted by a caller, shaping threads count locally and record once per batch of rows.
+  public func record(_ statistics: Statistics) {
+    guard statistics.fastPathRunsCount + statistics.shapedRunsCount > 0 else {
+      return
+    }
+    _statistics.withValue { $0.formUnion(statistics) }
+  }
+}
@@ -47,7 +47,6 @@ public struct Grid: Sendable, Identifiable {
     public var row: Int
     public var rowCells: [Cell]
     public var rowLayout: RowLayout
-    public var rowDrawRun: RowDrawRun
     public var dirtyRectangles: [IntegerRectangle]
     public var shouldUpdateCursorDrawRun: Bool
   }
@@ -56,9 +55,12 @@ public struct Grid: Sendable, Identifiable {
 
   public var id: Int
   public var layout: GridLayout
-  public var drawRuns: GridDrawRuns
+  /// Draw runs themselves are shaped lazily by the renderer, see `GridDrawRuns`.
+  public var cursorDrawRun: CursorDrawRun?
   public var associatedWindow: AssociatedWindow?
   public var isHidden: Bool
+  /// Columns written by `writeLine` since the row layout was last spliced, keyed by row.
+  public var pendingLineColumns: [Int: Range<Int>] = [:]
 
   public var size: IntegerSize {
     layout.size
@@ -77,7 +79,7 @@ public struct Grid: Sendable, Identifiable {
   }
 
   public var columnsCount: Int {
-    size.rowsCount
+    size.columnsCount
   }
 
   public var isFocusable: Bool {
@@ -93,35 +95,32 @@ public struct Grid: Sendable, Identifiable {
     }
   }
 
-  public init(
-    id: Int,
-    size: IntegerSize,
-    font: Font,
-    appearance: Appearance
-  ) {
-    let layout = GridLayout(cells: .init(
+  public init(id: Int, size: IntegerSize) {
+    self.id = id
+    layout = .init(cells: .init(
       size: size,
       repeatingElement: Cell.whitespace
     ))
-
-    self.id = id
-    self.layout = layout
-    drawRuns = .init(
-      layout: layout,
-      font: font,
-      appearance: appearance
-    )
+    cursorDrawRun = nil
     associatedWindow = nil
     isHidden = false
+    pendingLineColumns = [:]
   }
 
-  public mutating func apply(
-    update: Update,
-    font: Font,
-    appearance: Appearance
-  )
-    -> UpdateResult?
-  {
+  public mutating func apply(update: Update, font: Font) -> UpdateResult? {
+    switch update {
+    case .resize, .clear:
+      // Row layouts are rebuilt from cells, which already hold pending writes.
+      pendingLineColumns.removeAll(keepingCapacity: true)
+
+    case .scroll:
+      // Row layouts move with their rows, so they must include pending writes first.
+      materializePendingLines()
+
+    case .cursor, .clearCursor:
+      break
+    }
+
     switch update {
     case let .resize(integerSize):
       let copyColumnsCount = min(layout.columnsCount, integerSize.columnsCount)
@@ -132,107 +131,67 @@ public struct Grid: Sendable, Identifiable {
         repeatingElement: .whitespace
       )
       for row in 0 ..< copyRowsCount {
-        cells.rows[row].replaceSubrange(
+        cells.replaceSubrange(
           copyColumnsRange,
-          with: layout.cells.rows[row][copyColumnsRange]
+          inRow: row,
+          with: layout.cells[row: row, columns: copyColumnsRange]
         )
       }
       layout = .init(cells: cells)
 
-      let cursorDrawRun = drawRuns.cursorDrawRun
-      drawRuns = .init(
-        layout: layout,
-        font: font,
-        appearance: appearance
-      )
-
       if
         let cursorDrawRun,
-        cursorDrawRun.origin.column < integerSize.columnsCount,
-        cursorDrawRun.origin.row < integerSize.rowsCount
+        cursorDrawRun.origin.column >= integerSize.columnsCount
+        || cursorDrawRun.origin.row >= integerSize.rowsCount
       {
-        drawRuns.cursorDrawRun = cursorDrawRun
+        self.cursorDrawRun = nil
       }
 
       return .needsDisplay
 
     case let .scroll(rectangle, offset):
-      if offset.columnsCount != 0 {
-        logger.error("horizontal scroll not supported!!!")
+      let isRowsPermutation = rectangle.size.columnsCount == size.columnsCount
+        && offset.columnsCount == 0
+      if isRowsPermutation {
+        // Rows scrolled out of the region wrap around into the rows it exposes,
+        // Neovim always redraws those with following grid_line events.
+        layout.cells.rotateRows(in: rectangle.rows, by: offset.rowsCount)
+        layout.rowLayouts.rotate(in: rectangle.rows, by: offset.rowsCount)
+
+      } else {
+        layout.cells.moveElements(in: rectangle, by: offset)
       }
 
-      var shouldUpdateCursorDrawRun = false
-
-      let cellsCopy = layout.cells
-      let rowLayoutsCopy = layout.rowLayouts
-      let rowDrawRunsCopy = drawRuns.rowDrawRuns
-
       let toRectangle = rectangle
         .applying(offset: -offset)
         .intersection(with: rectangle)
 
-      for toRow in toRectangle.rows {
-        let fromRow = toRow + offset.rowsCount
-
-        if rectangle.size.columnsCount == size.columnsCount {
-          layout.cells.rows[toRow] = cellsCopy.rows[fromRow]
-          layout.rowLayouts[toRow] = rowLayoutsCopy[fromRow]
-          drawRuns.rowDrawRuns[toRow] = rowDrawRunsCopy[fromRow]
-        } else {
-          layout.cells.rows[toRow].replaceSubrange(
-            rectangle.columns,
-            with: cellsCopy.rows[fromRow][rectangle.columns]
-          )
-          layout.rowLayouts[toRow] = .init(rowCells: layout.cells.rows[toRow])
-          drawRuns.rowDrawRuns[toRow] = .init(
-            row: toRow,
-            layout: layout.rowLayouts[toRow],
-            font: font,
-            appearance: appearance,
-            old: drawRuns.rowDrawRuns[toRow]
-          )
-        }
-
-        if
-          drawRuns.cursorDrawRun != nil,
-          drawRuns.cursorDrawRun!.origin.row == toRow,
-          rectangle.columns.contains(drawRuns.cursorDrawRun!.origin.column)
-        {
-          shouldUpdateCursorDrawRun = true
+      if !isRowsPermutation {
+        for toRow in toRectangle.rows {
+          layout.rowLayouts[toRow] = .init(rowCells: layout.cells[row: toRow])
         }
       }
 
-      if shouldUpdateCursorDrawRun {
-        drawRuns.cursorDrawRun!.updateParent(
-          with: layout,
-          rowDrawRuns: drawRuns.rowDrawRuns
-        )
-      }
-
       return .dirtyRectangles([toRectangle])
 
     case .clear:
       layout.cells = .init(size: layout.cells.size, repeatingElement: .whitespace)
       layout.rowLayouts = layout.cells.rows
-        .map(RowLayout.init(rowCells:))
-      drawRuns.renderDrawRuns(for: layout, font: font, appearance: appearance)
+        .map { RowLayout(rowCells: $0) }
       return .needsDisplay
 
     case let .cursor(style, position):
       let columnsCount =
         if position.row < layout.rowsCount, position.column < layout.columnsCount {
-          layout.cells.rows[position.row][position.column].isDoubleWidth ? 2 : 1
+          layout.cells[.init(column: position.column, row: position.row)].isDoubleWidth ? 2 : 1
         } else {
           1
         }
-      drawRuns.cursorDrawRun = .init(
-        layout: layout,
-        rowDrawRuns: drawRuns.rowDrawRuns,
+      cursorDrawRun = .init(
         origin: position,
         columnsCount: columnsCount,
         style: style,
-        font: font,
-        appearance: appearance
+        font: font
       )
       return .dirtyRectangles(
         [
@@ -244,57 +203,67 @@ public struct Grid: Sendable, Identifiable {
       )
 
     case .clearCursor:
-      guard let cursorDrawRun = drawRuns.cursorDrawRun else {
+      guard let cursorDrawRun else {
         return nil
       }
-      drawRuns.cursorDrawRun = nil
+      self.cursorDrawRun = nil
       return .dirtyRectangles([cursorDrawRun.rectangle])
     }
   }
 
-  public mutating func applyLineUpdate(
+  /// Writes cells into the row and defers rebuilding its layout until `materializePendingLines()`,
+  /// so several writes to one row cost one rebuild.
+  /// `isCoalesced` is true when the row was already waiting for a rebuild.
+  public mutating func writeLine(
     originColumn: Int,
     cells: [Cell],
-    row: Int,
-    font: Font,
-    appearance: Appearance
+    row: Int
   )
-  -> IntegerRectangle {
-    layout.cells.rows[row].replaceSubrange(
-      originColumn ..< originColumn + cells.count,
-      with: cells
-    )
+    -> (dirtyRectangle: IntegerRectangle, isCoalesced: Bool)
+  {
+    let columns = originColumn ..< originColumn + cells.count
+    layout.cells.replaceSubrange(columns, inRow: row, with: cells)
 
-    layout.rowLayouts[row] = RowLayout(rowCells: layout.cells.rows[row])
-    drawRuns.rowDrawRuns[row] = RowDrawRun(
-      row: row,
-      layout: layout.rowLayouts[row],
-      font: font,
-      appearance: appearance,
-      old: drawRuns.rowDrawRuns[row]
-    )
+    let isCoalesced: Bool
+    if let pendingColumns = pendingLineColumns[row] {
+      pendingLineColumns[row] = min(pendingColumns.lowerBound, columns.lowerBound)
+        ..< max(pendingColumns.upperBound, columns.upperBound)
+      isCoalesced = true
 
-    return .init(
-      origin: .init(column: originColumn, row: row),
-      size: .init(columnsCount: cells.count, rowsCount: 1)
+    } else {
+      pendingLineColumns[row] = columns
+      isCoalesced = false
+    }
+
+    return (
+      dirtyRectangle: .init(
+        origin: .init(column: originColumn, row: row),
+        size: .init(columnsCount: cells.count, rowsCount: 1)
+      ),
+      isCoalesced: isCoalesced
     )
   }
 
-  public mutating func flushDrawRuns(font: Font, appearance: Appearance) {
-    for index in drawRuns.rowDrawRuns.indices {
-      drawRuns.rowDrawRuns[index].drawRunsCache.removeAll(keepingCapacity: true)
-    }
-    drawRuns.renderDrawRuns(for: layout, font: font, appearance: appearance)
-    if let cursorDrawRun = drawRuns.cursorDrawRun {
-      drawRuns.cursorDrawRun = .init(
-        layout: layout,
-        rowDrawRuns: drawRuns.rowDrawRuns,
-        origin: cursorDrawRun.origin,
-        columnsCount: cursorDrawRun.columnsCount,
-        style: cursorDrawRun.style,
-        font: font,
-        appearance: appearance
+  public mutating func materializePendingLines() {
+    for (row, columns) in pendingLineColumns {
+      layout.rowLayouts[row].splice(
+        rowCells: layout.cells[row: row],
+        changedColumns: columns
       )
     }
+    pendingLineColumns.removeAll(keepingCapacity: true)
+  }
+
+  /// Cursor cell frame depends on font metrics.
+  public mutating func updateCursorDrawRun(font: Font) {
+    guard let cursorDrawRun else {
+      return
+    }
+    self.cursorDrawRun = .init(
+      origin: cursorDrawRun.origin,
+      columnsCount: cursorDrawRun.columnsCount,
+      style: cursorDrawRun.style,
+      font: font
+    )
   }
 }
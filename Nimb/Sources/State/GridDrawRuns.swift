@@ -1,81 +1,252 @@
 // SPDX-License-Identifier: MIT
 
 import AppKit
-import Collections
 import ConcurrencyExtras
 import CustomDump
 import SwiftUI
 
-@PublicInit
-public struct GridDrawRuns: Sendable {
-  public var rowDrawRuns: [RowDrawRun]
-  public var cursorDrawRun: CursorDrawRun?
+/// Draw runs of a grid, shaped on demand while drawing and memoized by row layout revision.
+///
+/// The reducer only updates `RowLayout`s, so shaping is spent only on rows a renderer actually draws
+/// and never on hidden grids or intermediate states. Memoized draw runs follow their layouts
+/// through scrolling, and a changed row reuses the unchanged draw runs of the row drawn before it.
+/// Not thread safe, meant to be owned by a single renderer.
+public final class GridDrawRuns {
+  private struct ShapingJob: Sendable {
+    var row: Int
+    var layout: RowLayout
+    var old: RowDrawRun?
+  }
 
-  public init(
+  /// Fewer missing rows than this are shaped on the drawing thread, fanning out would cost more.
+  private static let minimumParallelRowsCount = 4
+
+  /// Maximum number of threads shaping rows in `prepareRows`.
+  public let workersCount: Int
+
+  private var rowDrawRuns = [RowLayout.Revision: RowDrawRun]()
+  private var drawnRevisions = [RowLayout.Revision?]()
+
+  public init(workersCount: Int = ProcessInfo.processInfo.activeProcessorCount) {
+    self.workersCount = max(1, workersCount)
+  }
+
+  /// Shaping depends on font and highlights, so memoized draw runs are dropped when those change.
+  public func removeAll() {
+    rowDrawRuns.removeAll(keepingCapacity: true)
+    drawnRevisions.removeAll(keepingCapacity: true)
+  }
+
+  /// Drops memoized draw runs of `revisions`, for example rows using a redefined highlight.
+  public func remove(revisions: Set<RowLayout.Revision>) {
+    for revision in revisions {
+      rowDrawRuns.removeValue(forKey: revision)
+    }
+  }
+
+  /// Drops memoized draw runs of layouts that are not part of `layout` anymore.
+  public func removeUnused(for layout: GridLayout) {
+    guard rowDrawRuns.count > layout.rowsCount * 2 else {
+      return
+    }
+    let revisions = Set(layout.rowLayouts.map(\.revision))
+    rowDrawRuns = rowDrawRuns.filter { revisions.contains($0.key) }
+  }
+
+  /// Shapes all rows in `rows` that have no memoized draw runs yet in parallel, so drawing
+  /// a large dirty area after a font change or a flush does not shape rows one by one.
+  ///
+  /// Workers pull rows from a shared counter and collect results into their own buffers,
+  /// which are merged by row afterwards, so the outcome does not depend on scheduling.
+  public func prepareRows(
+    _ rows: Range<Int>,
     layout: GridLayout,
     font: Font,
     appearance: Appearance
   ) {
-    rowDrawRuns = []
-    renderDrawRuns(for: layout, font: font, appearance: appearance)
+    syncRowsCount(with: layout)
+
+    let jobs = rows.clamped(to: 0 ..< layout.rowsCount).compactMap { row -> ShapingJob? in
+      let rowLayout = layout.rowLayouts[row]
+      guard rowDrawRuns[rowLayout.revision] == nil else {
+        return nil
+      }
+      return .init(
+        row: row,
+        layout: rowLayout,
+        old: drawnRevisions[row].flatMap { rowDrawRuns[$0] }
+      )
+    }
+    guard jobs.count >= Self.minimumParallelRowsCount, workersCount > 1 else {
+      return
+    }
+
+    let nextJobIndex = LockIsolated(0)
+    let workerResults = LockIsolated([[(jobIndex: Int, rowDrawRun: RowDrawRun)]]())
+    let glyphRunsStatistics = LockIsolated(GlyphTables.Statistics())
+
+    DispatchQueue.concurrentPerform(iterations: min(workersCount, jobs.count)) { _ in
+      var results = [(jobIndex: Int, rowDrawRun: RowDrawRun)]()
+      var statistics = GlyphTables.Statistics()
+      while true {
+        let jobIndex = nextJobIndex.withValue { nextJobIndex in
+          defer { nextJobIndex += 1 }
+          return nextJobIndex
+        }
+        guard jobIndex < jobs.count else {
+          break
+        }
+        let job = jobs[jobIndex]
+        results.append((
+          jobIndex: jobIndex,
+          rowDrawRun: RowDrawRun(
+            row: job.row,
+            layout: job.layout,
+            font: font,
+            appearance: appearance,
+            old: job.old,
+            glyphRunsStatistics: &statistics
+          )
+        ))
+      }
+      workerResults.withValue { [results] in $0.append(results) }
+      glyphRunsStatistics.withValue { [statistics] in $0.formUnion(statistics) }
+    }
+    GlyphTables.shared.record(glyphRunsStatistics.value)
+
+    for results in workerResults.value {
+      for (jobIndex, rowDrawRun) in results {
+        let job = jobs[jobIndex]
+        rowDrawRuns[job.layout.revision] = rowDrawRun
+        drawnRevisions[job.row] = job.layout.revision
+      }
+    }
   }
 
-  public mutating func renderDrawRuns(
-    for layout: GridLayout,
+  public func rowDrawRun(
+    forRow row: Int,
+    layout: GridLayout,
     font: Font,
     appearance: Appearance
-  ) {
-    rowDrawRuns = layout.rowLayouts
-      .enumerated()
-      .map { row, layout in
-        .init(
-          row: row,
-          layout: layout,
-          font: font,
-          appearance: appearance,
-          old: row < rowDrawRuns.count ? rowDrawRuns[row] : nil
-        )
-      }
+  )
+    -> RowDrawRun
+  {
+    syncRowsCount(with: layout)
+
+    let rowLayout = layout.rowLayouts[row]
+    if let rowDrawRun = rowDrawRuns[rowLayout.revision] {
+      drawnRevisions[row] = rowLayout.revision
+      return rowDrawRun
+    }
+
+    var glyphRunsStatistics = GlyphTables.Statistics()
+    let rowDrawRun = RowDrawRun(
+      row: row,
+      layout: rowLayout,
+      font: font,
+      appearance: appearance,
+      old: drawnRevisions[row].flatMap { rowDrawRuns[$0] },
+      glyphRunsStatistics: &glyphRunsStatistics
+    )
+    GlyphTables.shared.record(glyphRunsStatistics)
+    rowDrawRuns[rowLayout.revision] = rowDrawRun
+    drawnRevisions[row] = rowLayout.revision
+    return rowDrawRun
   }
 
+  /// Fills backgrounds with a single call per color.
+  ///
+  /// Runs of equal color are merged into spans along each row, spans with equal columns and color
+  /// in consecutive rows are merged into one rectangle. Spans of `clearedBackgroundColor`, which the layer
+  /// already shows beneath its contents, are not filled at all.
   public func drawBackground(
     to context: CGContext,
+    layout: GridLayout,
     boundingRect: IntegerRectangle,
     font: Font,
     appearance: Appearance,
+    clearedBackgroundColor: Color?,
     upsideDownTransform: CGAffineTransform
   ) {
     let fromRow = max(boundingRect.minRow, 0)
-    let toRow = min(boundingRect.maxRow, rowDrawRuns.count)
+    let toRow = min(boundingRect.maxRow, layout.rowsCount)
     guard fromRow < toRow else {
       return
     }
-    for row in fromRow ..< toRow {
-      rowDrawRuns[row].drawBackground(
-        columnsRange: boundingRect.columns,
-        at: .init(x: 0, y: Double(row) * font.cellHeight),
-        to: context,
-        font: font,
-        appearance: appearance,
-        upsideDownTransform: upsideDownTransform
+
+    var rectsByColor = [Color: (cgColor: CGColor, rects: [CGRect])]()
+    var openSpans = [BackgroundSpan: Int]()
+
+    func close(_ span: BackgroundSpan, fromRow: Int, toRow: Int) {
+      let rect = (
+        IntegerRectangle(
+          origin: .init(column: span.columns.lowerBound, row: fromRow),
+          size: .init(columnsCount: span.columns.count, rowsCount: toRow - fromRow)
+        ) * font.cellSize
       )
+      .applying(upsideDownTransform)
+      rectsByColor[span.color, default: (span.cgColor, [])].rects.append(rect)
+    }
+
+    for row in fromRow ..< toRow {
+      let spans = rowDrawRun(forRow: row, layout: layout, font: font, appearance: appearance)
+        .backgroundSpans(columnsRange: boundingRect.columns, appearance: appearance)
+        .filter { $0.color != clearedBackgroundColor }
+
+      var nextOpenSpans = [BackgroundSpan: Int]()
+      for span in spans {
+        nextOpenSpans[span] = openSpans.removeValue(forKey: span) ?? row
+      }
+      for (span, spanFromRow) in openSpans {
+        close(span, fromRow: spanFromRow, toRow: row)
+      }
+      openSpans = nextOpenSpans
+    }
+    for (span, spanFromRow) in openSpans {
+      close(span, fromRow: spanFromRow, toRow: toRow)
+    }
+
+    for (cgColor, rects) in rectsByColor.values {
+      context.setFillColor(cgColor)
+      context.fill(rects)
     }
   }
 
+  /// Strokes decorations of all rows first, batched into one path per color and dash pattern,
+  /// and then draws glyphs over them.
   public func drawForeground(
     to context: CGContext,
+    layout: GridLayout,
     boundingRect: IntegerRectangle,
     font: Font,
     appearance: Appearance,
     upsideDownTransform: CGAffineTransform
   ) {
     let fromRow = max(boundingRect.minRow, 0)
-    let toRow = min(boundingRect.maxRow, rowDrawRuns.count)
+    let toRow = min(boundingRect.maxRow, layout.rowsCount)
     guard fromRow < toRow else {
       return
     }
-    for row in fromRow ..< toRow {
-      rowDrawRuns[row].drawForeground(
+    let drawnRows = (fromRow ..< toRow).map { row in
+      (row, rowDrawRun(forRow: row, layout: layout, font: font, appearance: appearance))
+    }
+
+    var decorationPaths = DecorationPaths()
+    for (row, rowDrawRun) in drawnRows {
+      rowDrawRun.addDecorations(
+        to: &decorationPaths,
+        columnsRange: boundingRect.columns,
+        at: .init(x: 0, y: Double(row) * font.cellHeight),
+        font: font,
+        appearance: appearance,
+        upsideDownTransform: upsideDownTransform
+      )
+    }
+    decorationPaths.stroke(in: context)
+
+    context.setTextDrawingMode(.fill)
+    for (row, rowDrawRun) in drawnRows {
+      rowDrawRun.drawGlyphs(
         columnsRange: boundingRect.columns,
         at: .init(x: 0, y: Double(row) * font.cellHeight),
         to: context,
@@ -85,6 +256,54 @@ public struct GridDrawRuns: Sendable {
       )
     }
   }
+
+  /// Draws backgrounds with antialiasing disabled, so cell edges stay sharp, and foregrounds over them.
+  ///
+  /// This is what `GridLayer` rasterizes its row tiles with, and what `SoftwareGridRenderer` is
+  /// compared against.
+  public func draw(
+    to context: CGContext,
+    layout: GridLayout,
+    backgroundRect: IntegerRectangle,
+    foregroundRect: IntegerRectangle,
+    font: Font,
+    appearance: Appearance,
+    clearedBackgroundColor: Color?,
+    upsideDownTransform: CGAffineTransform
+  ) {
+    context.setAllowsAntialiasing(false)
+    context.setAllowsFontSmoothing(false)
+    context.setShouldAntialias(false)
+    context.setShouldSmoothFonts(false)
+    drawBackground(
+      to: context,
+      layout: layout,
+      boundingRect: backgroundRect,
+      font: font,
+      appearance: appearance,
+      clearedBackgroundColor: clearedBackgroundColor,
+      upsideDownTransform: upsideDownTransform
+    )
+
+    context.setAllowsAntialiasing(true)
+    context.setAllowsFontSmoothing(true)
+    context.setShouldAntialias(true)
+    context.setShouldSmoothFonts(true)
+    drawForeground(
+      to: context,
+      layout: layout,
+      boundingRect: foregroundRect,
+      font: font,
+      appearance: appearance,
+      upsideDownTransform: upsideDownTransform
+    )
+  }
+
+  private func syncRowsCount(with layout: GridLayout) {
+    if drawnRevisions.count != layout.rowsCount {
+      drawnRevisions = .init(repeating: nil, count: layout.rowsCount)
+    }
+  }
 }
 
 @PublicInit
@@ -97,7 +316,8 @@ public struct RowDrawRun: Sendable {
     layout: RowLayout,
     font: Font,
     appearance: Appearance,
-    old: RowDrawRun?
+    old: RowDrawRun?,
+    glyphRunsStatistics: inout GlyphTables.Statistics
   ) {
     var drawRuns = [DrawRun]()
     var drawRunsCache = [RowPartContent: (index: Int, drawRun: DrawRun)]()
@@ -124,7 +344,8 @@ public struct RowDrawRun: Sendable {
         originColumn: part.originColumn,
         highlightID: part.highlightID,
         font: font,
-        appearance: appearance
+        appearance: appearance,
+        glyphRunsStatistics: &glyphRunsStatistics
       )
       drawRun.originColumn = part.originColumn
       drawRun.highlightID = part.highlightID
@@ -139,33 +360,49 @@ public struct RowDrawRun: Sendable {
     self.drawRunsCache = drawRunsCache
   }
 
-  public func drawBackground(
+  /// Adjacent runs of equal background color within `columnsRange` merged into spans.
+  func backgroundSpans(columnsRange: Range<Int>, appearance: Appearance) -> [BackgroundSpan] {
+    var spans = [BackgroundSpan]()
+    for drawRun in drawRuns where drawRun.columnsRange.overlaps(columnsRange) {
+      let style = appearance.style(for: drawRun.highlightID)
+      if
+        let last = spans.last,
+        last.color == style.backgroundColor,
+        last.columns.upperBound == drawRun.columnsRange.lowerBound
+      {
+        spans[spans.count - 1].columns = last.columns.lowerBound ..< drawRun.columnsRange.upperBound
+      } else {
+        spans.append(
+          .init(
+            columns: drawRun.columnsRange,
+            color: style.backgroundColor,
+            cgColor: style.backgroundCGColor
+          )
+        )
+      }
+    }
+    return spans
+  }
+
+  public func addDecorations(
+    to decorationPaths: inout DecorationPaths,
     columnsRange: Range<Int>,
     at origin: CGPoint,
-    to context: CGContext,
     font: Font,
     appearance: Appearance,
     upsideDownTransform: CGAffineTransform
   ) {
     for drawRun in drawRuns where drawRun.columnsRange.overlaps(columnsRange) {
-      let rect = CGRect(
-        x: Double(drawRun.columnsRange.lowerBound) * font.cellWidth + origin.x,
-        y: origin.y,
-        width: Double(drawRun.columnsRange.count) * font.cellWidth,
-        height: font.cellHeight
-      )
-      .applying(upsideDownTransform)
-
-      drawRun.drawBackground(
-        to: context,
-        at: rect.origin,
+      drawRun.addDecorations(
+        to: &decorationPaths,
+        at: drawRun.rect(at: origin, font: font, upsideDownTransform: upsideDownTransform),
         font: font,
         appearance: appearance
       )
     }
   }
 
-  public func drawForeground(
+  public func drawGlyphs(
     columnsRange: Range<Int>,
     at origin: CGPoint,
     to context: CGContext,
@@ -174,24 +411,87 @@ public struct RowDrawRun: Sendable {
     upsideDownTransform: CGAffineTransform
   ) {
     for drawRun in drawRuns where drawRun.columnsRange.overlaps(columnsRange) {
-      let rect = CGRect(
-        x: Double(drawRun.columnsRange.lowerBound) * font.cellWidth + origin.x,
-        y: origin.y,
-        width: Double(drawRun.columnsRange.count) * font.cellWidth,
-        height: font.cellHeight
-      )
-      .applying(upsideDownTransform)
-
-      drawRun.drawForeground(
+      drawRun.drawGlyphs(
         to: context,
-        at: rect,
-        font: font,
+        at: drawRun.rect(at: origin, font: font, upsideDownTransform: upsideDownTransform),
         appearance: appearance
       )
     }
   }
 }
 
+/// Columns of a row filled with a single background color.
+struct BackgroundSpan: Hashable {
+  var columns: Range<Int>
+  var color: Color
+  var cgColor: CGColor
+
+  static func == (lhs: BackgroundSpan, rhs: BackgroundSpan) -> Bool {
+    lhs.columns == rhs.columns && lhs.color == rhs.color
+  }
+
+  func hash(into hasher: inout Hasher) {
+    hasher.combine(columns)
+    hasher.combine(color)
+  }
+}
+
+/// Decoration strokes of a drawn region, one path per color and dash pattern.
+public struct DecorationPaths {
+  public enum Pattern: Hashable, Sendable {
+    case solid
+    case dashed
+    case dotted
+
+    var dashLengths: [CGFloat] {
+      switch self {
+      case .solid:
+        []
+
+      case .dashed:
+        [2, 2]
+
+      case .dotted:
+        [1, 1]
+      }
+    }
+  }
+
+  private struct Key: Hashable {
+    var color: Color
+    var pattern: Pattern
+  }
+
+  private var paths = [Key: (cgColor: CGColor, path: CGMutablePath)]()
+
+  public init() { }
+
+  public mutating func path(color: Color, cgColor: CGColor, pattern: Pattern) -> CGMutablePath {
+    let key = Key(color: color, pattern: pattern)
+    if let entry = paths[key] {
+      return entry.path
+    }
+    let path = CGMutablePath()
+    paths[key] = (cgColor, path)
+    return path
+  }
+
+  public func stroke(in context: CGContext) {
+    guard !paths.isEmpty else {
+      return
+    }
+    context.setLineWidth(1)
+    for (key, (cgColor, path)) in paths {
+      context.setStrokeColor(cgColor)
+      // Dash phase restarts with every subpath, so every run starts its pattern at its own origin.
+      context.setLineDash(phase: 0.5, lengths: key.pattern.dashLengths)
+      context.addPath(path)
+      context.strokePath()
+    }
+    context.setLineDash(phase: 0, lengths: [])
+  }
+}
+
 @PublicInit
 public struct DrawRun: Sendable {
   public var rowPartContent: RowPartContent
@@ -212,100 +512,44 @@ public struct DrawRun: Sendable {
     originColumn: Int,
     highlightID: Highlight.ID,
     font: Font,
-    appearance: Appearance
+    appearance: Appearance,
+    glyphRunsStatistics: inout GlyphTables.Statistics
   ) {
-    let isBold = appearance.isBold(for: highlightID)
-    let isItalic = appearance.isItalic(for: highlightID)
+    let style = appearance.style(for: highlightID)
+    let isBold = style.isBold
+    let isItalic = style.isItalic
 
-    let shouldUseCache: Bool =
-      if case let .cells(array) = rowPartContent {
-        array.count < 6
+    let cacheKey: DrawRunsCache.Key? =
+      if case .cells = rowPartContent {
+        .init(
+          rowPartContent: rowPartContent,
+          font: font,
+          isBold: isBold,
+          isItalic: isItalic
+        )
       } else {
-        false
+        nil
       }
-    var cacheKey: Int?
-    if shouldUseCache {
-      var hasher = Hasher()
-      hasher.combine(rowPartContent)
-      hasher.combine(font)
-      hasher.combine(isBold)
-      hasher.combine(isItalic)
-      cacheKey = hasher.finalize()
-    }
-    if
-      let cacheKey, let cachedDrawRun = GlobalDrawRunsCache.shared.drawRun(
-        for: cacheKey
-      )
-    {
+    if let cacheKey, let cachedDrawRun = DrawRunsCache.shared.drawRun(for: cacheKey) {
       self = cachedDrawRun
+      self.originColumn = originColumn
+      self.highlightID = highlightID
     } else if case let .cells(cells) = rowPartContent {
-      let appKitFont = font.appKit(
-        isBold: isBold,
-        isItalic: isItalic
+      let glyphTable = GlyphTables.shared.table(
+        for: .init(font: font, isBold: isBold, isItalic: isItalic)
       )
-
-      let attributedString = NSAttributedString(
-        string: .init(cells.map(\.character)),
-        attributes: [.font: appKitFont]
-      )
-
-      let ctTypesetter = CTTypesetterCreateWithAttributedStringAndOptions(
-        attributedString,
-        nil
-      )!
-      let ctLine = CTTypesetterCreateLine(ctTypesetter, .init())
-
-      var ascent: CGFloat = 0
-      var descent: CGFloat = 0
-      var leading: CGFloat = 0
-      CTLineGetTypographicBounds(ctLine, &ascent, &descent, &leading)
-      let bounds = CTLineGetBoundsWithOptions(ctLine, [])
-
-      let xOffset = (font.cellWidth - bounds.width / Double(cells.count)) /
-        2
-      let yOffset = (font.cellHeight - bounds.height) / 2 + descent
-      let offset = CGPoint(x: xOffset, y: yOffset)
-
-      let ctRuns = CTLineGetGlyphRuns(ctLine) as! [CTRun]
-
-      let glyphRuns = ctRuns
-        .map { ctRun -> GlyphRun in
-          let glyphCount = CTRunGetGlyphCount(ctRun)
-
-          let glyphs =
-            [CGGlyph](unsafeUninitializedCapacity: glyphCount)
-          { buffer, initializedCount in
-            CTRunGetGlyphs(ctRun, .init(), buffer.baseAddress!)
-            initializedCount = glyphCount
-          }
-
-          let positions =
-            [CGPoint](unsafeUninitializedCapacity: glyphCount)
-          { buffer, initializedCount in
-            CTRunGetPositions(ctRun, .init(), buffer.baseAddress!)
-            initializedCount = glyphCount
-          }
-          .map { $0 + offset }
-
-          let advances =
-            [CGSize](unsafeUninitializedCapacity: glyphCount)
-          { buffer, initializedCount in
-            CTRunGetAdvances(ctRun, .init(), buffer.baseAddress!)
-            initializedCount = glyphCount
-          }
-
-          let attributes =
-            CTRunGetAttributes(ctRun) as! [NSAttributedString.Key: Any]
-          let attributesFont = attributes[.font] as? NSFont
-
-          return .init(
-            appKitFont: attributesFont ?? appKitFont,
-            textMatrix: CTRunGetTextMatrix(ctRun),
-            glyphs: glyphs,
-            positions: positions,
-            advances: advances
-          )
-        }
+      let glyphRuns: [GlyphRun]
+      if let glyphRun = glyphTable.glyphRun(for: cells) {
+        glyphRuns = [glyphRun]
+        glyphRunsStatistics.recordRun(isFastPath: true)
+      } else {
+        glyphRuns = Self.makeShapedGlyphRuns(
+          cells: cells,
+          font: font,
+          appKitFont: style.appKitFont(font)
+        )
+        glyphRunsStatistics.recordRun(isFastPath: false)
+      }
 
       let drawRun = DrawRun(
         rowPartContent: rowPartContent,
@@ -314,7 +558,7 @@ public struct DrawRun: Sendable {
         glyphRuns: glyphRuns
       )
       if let cacheKey {
-        GlobalDrawRunsCache.shared.store(drawRun, forKey: cacheKey)
+        DrawRunsCache.shared.store(drawRun, for: cacheKey)
       }
       self = drawRun
     } else {
@@ -322,70 +566,138 @@ public struct DrawRun: Sendable {
     }
   }
 
-  public func drawBackground(
-    to context: CGContext,
+  /// Lays out `cells` with the typesetter, which handles ligatures, combining marks and font fallback.
+  static func makeShapedGlyphRuns(
+    cells: [RowPartCell],
+    font: Font,
+    appKitFont: NSFont
+  )
+    -> [GlyphRun]
+  {
+    let attributedString = NSAttributedString(
+      string: cells.map(\.text).joined(),
+      attributes: [.font: appKitFont]
+    )
+
+    let ctTypesetter = CTTypesetterCreateWithAttributedStringAndOptions(
+      attributedString,
+      nil
+    )!
+    let ctLine = CTTypesetterCreateLine(ctTypesetter, .init())
+
+    var ascent: CGFloat = 0
+    var descent: CGFloat = 0
+    var leading: CGFloat = 0
+    CTLineGetTypographicBounds(ctLine, &ascent, &descent, &leading)
+    let bounds = CTLineGetBoundsWithOptions(ctLine, [])
+
+    let xOffset = (font.cellWidth - bounds.width / Double(cells.count)) /
+      2
+    let yOffset = (font.cellHeight - bounds.height) / 2 + descent
+    let offset = CGPoint(x: xOffset, y: yOffset)
+
+    let ctRuns = CTLineGetGlyphRuns(ctLine) as! [CTRun]
+
+    return ctRuns
+      .map { ctRun -> GlyphRun in
+        let glyphCount = CTRunGetGlyphCount(ctRun)
+
+        let glyphs =
+          [CGGlyph](unsafeUninitializedCapacity: glyphCount)
+        { buffer, initializedCount in
+          CTRunGetGlyphs(ctRun, .init(), buffer.baseAddress!)
+          initializedCount = glyphCount
+        }
+
+        let positions =
+          [CGPoint](unsafeUninitializedCapacity: glyphCount)
+        { buffer, initializedCount in
+          CTRunGetPositions(ctRun, .init(), buffer.baseAddress!)
+          initializedCount = glyphCount
+        }
+        .map { $0 + offset }
+
+        let advances =
+          [CGSize](unsafeUninitializedCapacity: glyphCount)
+        { buffer, initializedCount in
+          CTRunGetAdvances(ctRun, .init(), buffer.baseAddress!)
+          initializedCount = glyphCount
+        }
+
+        let attributes =
+          CTRunGetAttributes(ctRun) as! [NSAttributedString.Key: Any]
+        let attributesFont = attributes[.font] as? NSFont
+
+        return .init(
+          appKitFont: attributesFont ?? appKitFont,
+          textMatrix: CTRunGetTextMatrix(ctRun),
+          glyphs: glyphs,
+          positions: positions,
+          advances: advances
+        )
+      }
+  }
+
+  /// `origin` is the origin of the row, the returned rect is in the coordinates of the drawing context.
+  public func rect(
     at origin: CGPoint,
     font: Font,
-    appearance: Appearance
-  ) {
-    let rect = CGRect(
-      origin: origin,
-      size: .init(
-        width: Double(rowPartContent.columnsCount) * font.cellWidth,
-        height: font.cellHeight
-      )
+    upsideDownTransform: CGAffineTransform
+  )
+    -> CGRect
+  {
+    CGRect(
+      x: Double(columnsRange.lowerBound) * font.cellWidth + origin.x,
+      y: origin.y,
+      width: Double(columnsRange.count) * font.cellWidth,
+      height: font.cellHeight
     )
-    context.setFillColor(appearance.backgroundColor(for: highlightID).cg)
-    context.fill([rect])
+    .applying(upsideDownTransform)
   }
 
-  public func drawForeground(
-    to context: CGContext,
+  public func addDecorations(
+    to decorationPaths: inout DecorationPaths,
     at rect: CGRect,
     font: Font,
     appearance: Appearance
   ) {
-    guard case let .cells(cells) = rowPartContent, let glyphRuns else {
+    guard case let .cells(cells) = rowPartContent, glyphRuns != nil else {
       return
     }
 
-    let decorations = appearance.decorations(for: highlightID)
-    let specialColor = appearance.specialColor(for: highlightID)
-    let specialCGColor = specialColor.cg
+    let style = appearance.style(for: highlightID)
+    let decorations = style.decorations
 
-    context.setLineWidth(1)
-    context.setStrokeColor(specialCGColor)
+    func path(_ pattern: DecorationPaths.Pattern) -> CGMutablePath {
+      decorationPaths.path(color: style.specialColor, cgColor: style.specialCGColor, pattern: pattern)
+    }
 
     if decorations.isStrikethrough {
       let strikethroughY = rect.height / 2 + rect.origin.y
 
-      context.beginPath()
-      context.move(to: .init(x: rect.minX, y: strikethroughY))
-      context.addLine(to: .init(x: rect.maxX, y: strikethroughY))
-      context.drawPath(using: .stroke)
+      let path = path(.solid)
+      path.move(to: .init(x: rect.minX, y: strikethroughY))
+      path.addLine(to: .init(x: rect.maxX, y: strikethroughY))
     }
 
     let underlineY = rect.origin.y + 0.5
 
     if decorations.isUnderline || decorations.isUnderdashed || decorations.isUnderdotted {
-      context.beginPath()
-      if decorations.isUnderdashed {
-        context.setLineDash(phase: 0.5, lengths: [2, 2])
-      } else if decorations.isUnderdotted {
-        context.setLineDash(phase: 0.5, lengths: [1, 1])
-      }
-      context.move(to: .init(x: rect.minX, y: underlineY))
-      context.addLine(to: .init(x: rect.maxX, y: underlineY))
-      context.drawPath(using: .stroke)
+      let path = path(
+        decorations.isUnderdashed ? .dashed : decorations.isUnderdotted ? .dotted : .solid
+      )
+      path.move(to: .init(x: rect.minX, y: underlineY))
+      path.addLine(to: .init(x: rect.maxX, y: underlineY))
+
     } else if decorations.isUnderdouble {
-      context.beginPath()
-      context.move(to: .init(x: rect.minX, y: underlineY))
-      context.addLine(to: .init(x: rect.maxX, y: underlineY))
-      context.move(to: .init(x: rect.minX, y: underlineY + 3))
-      context.addLine(to: .init(x: rect.maxX, y: underlineY + 3))
-      context.drawPath(using: .stroke)
+      let path = path(.solid)
+      path.move(to: .init(x: rect.minX, y: underlineY))
+      path.addLine(to: .init(x: rect.maxX, y: underlineY))
+      path.move(to: .init(x: rect.minX, y: underlineY + 3))
+      path.addLine(to: .init(x: rect.maxX, y: underlineY + 3))
+
     } else if decorations.isUndercurl {
-      context.beginPath()
+      let path = path(.solid)
 
       let widthDivider = 3
 
@@ -395,22 +707,31 @@ public struct DrawRun: Sendable {
       let oddUnderlineY = underlineY + 3
       let evenUnderlineY = underlineY
 
-      context.move(to: .init(x: rect.minX, y: evenUnderlineY))
+      path.move(to: .init(x: rect.minX, y: evenUnderlineY))
       for index in 1 ..< pointsCount {
         let isEven = index.isMultiple(of: 2)
 
-        context.addLine(
+        path.addLine(
           to: .init(
             x: rect.minX + Double(index) * xStep,
             y: isEven ? evenUnderlineY : oddUnderlineY
           )
         )
       }
-      context.drawPath(using: .stroke)
     }
+  }
 
-    context.setTextDrawingMode(.fill)
-    context.setFillColor(appearance.foregroundColor(for: highlightID).cg)
+  /// Expects the text drawing mode to be `.fill`.
+  public func drawGlyphs(
+    to context: CGContext,
+    at rect: CGRect,
+    appearance: Appearance
+  ) {
+    guard let glyphRuns else {
+      return
+    }
+
+    context.setFillColor(appearance.style(for: highlightID).foregroundCGColor)
 
     for glyphRun in glyphRuns {
       context.textMatrix = glyphRun.textMatrix
@@ -446,8 +767,6 @@ public struct CursorDrawRun: Sendable {
   public var style: CursorStyle
   public var cellFrame: CGRect
   public var highlightID: Highlight.ID
-  public var parentOrigin: IntegerPoint
-  public var parentDrawRun: DrawRun
   public var shouldDrawParentText: Bool
 
   public var rectangle: IntegerRectangle {
@@ -461,63 +780,12 @@ public struct CursorDrawRun: Sendable {
   }
 
   init?(
-    layout: GridLayout,
-    rowDrawRuns: [RowDrawRun],
     origin: IntegerPoint,
     columnsCount: Int,
     style: CursorStyle,
-    font: Font,
-    appearance: Appearance
+    font: Font
   ) {
-    var parentOrigin: IntegerPoint?
-    var parentDrawRun: DrawRun?
-    var cursorColumnsRange: Range<Int>?
-
-    var rowPartCellsCount = 0
-
-    drawRunsLoop:
-      for drawRun in rowDrawRuns[origin.row].drawRuns
-    {
-      if drawRun.columnsRange.contains(origin.column) {
-        parentOrigin = .init(
-          column: drawRun.originColumn,
-          row: origin.row
-        )
-        parentDrawRun = drawRun
-        switch drawRun.rowPartContent {
-        case let .cells(cells):
-          for (rowPartCellIndex, rowPartCell) in cells.enumerated() {
-            let lowerBound = rowPartCellsCount + rowPartCellIndex
-            let upperBound = lowerBound + (rowPartCell.isDoubleWidth ? 2 : 1)
-            let range = lowerBound ..< upperBound
-            if range.contains(origin.column) {
-              cursorColumnsRange = range
-              break drawRunsLoop
-            }
-          }
-
-        case .whitespace:
-          cursorColumnsRange = origin.column ..< origin.column + 1
-          break drawRunsLoop
-        }
-        logger.fault("inconsistency error")
-        break
-      }
-
-      rowPartCellsCount += drawRun.columnsCount
-    }
-    guard
-      let parentOrigin,
-      let parentDrawRun,
-      let cursorColumnsRange,
-      let cellFrame = style.cellFrame(
-        columnsCount: cursorColumnsRange.count,
-        font: font
-      )
-    else {
-      Task { @MainActor in
-        logger.fault("inconsistency error")
-      }
+    guard let cellFrame = style.cellFrame(columnsCount: columnsCount, font: font) else {
       return nil
     }
     self = .init(
@@ -526,42 +794,30 @@ public struct CursorDrawRun: Sendable {
       style: style,
       cellFrame: cellFrame,
       highlightID: style.attrID ?? Highlight.defaultID,
-      parentOrigin: parentOrigin,
-      parentDrawRun: parentDrawRun,
       shouldDrawParentText: style.shouldDrawParentText
     )
   }
 
-  public mutating func updateParent(
-    with layout: GridLayout,
-    rowDrawRuns: [RowDrawRun]
-  ) {
-    var currentColumn = 0
-    for drawRun in rowDrawRuns[origin.row].drawRuns {
-      if drawRun.columnsRange.contains(origin.column) {
-        parentOrigin = .init(column: currentColumn, row: origin.row)
-        parentDrawRun = drawRun
-      }
-      currentColumn += drawRun.columnsCount
-    }
-  }
-
+  /// `rowDrawRun` is the draw run of the cursor row, its text under the cursor is drawn in cursor colors.
+  /// Expects antialiasing to be allowed, as the foreground pass leaves it.
   public func draw(
     to context: CGContext,
+    rowDrawRun: RowDrawRun,
     font: Font,
     appearance: Appearance,
     upsideDownTransform: CGAffineTransform
   ) {
-    let cursorForegroundColor: Color
-    let cursorBackgroundColor: Color
+    let cursorForegroundColor: CGColor
+    let cursorBackgroundColor: CGColor
 
     if highlightID == .zero {
-      cursorForegroundColor = appearance.defaultBackgroundColor
-      cursorBackgroundColor = appearance.defaultForegroundColor
+      cursorForegroundColor = appearance.defaultStyle.backgroundCGColor
+      cursorBackgroundColor = appearance.defaultStyle.foregroundCGColor
 
     } else {
-      cursorForegroundColor = appearance.foregroundColor(for: highlightID)
-      cursorBackgroundColor = appearance.backgroundColor(for: highlightID)
+      let style = appearance.style(for: highlightID)
+      cursorForegroundColor = style.foregroundCGColor
+      cursorBackgroundColor = style.backgroundCGColor
     }
 
     let offset = origin * font.cellSize
@@ -569,19 +825,22 @@ public struct CursorDrawRun: Sendable {
       .offsetBy(dx: offset.x, dy: offset.y)
       .applying(upsideDownTransform)
 
-    context.setAllowsAntialiasing(false)
     context.setShouldAntialias(false)
 
-    context.setFillColor(cursorBackgroundColor.cg)
+    context.setFillColor(cursorBackgroundColor)
     context.fill([rect])
 
-    if shouldDrawParentText, let glyphRuns = parentDrawRun.glyphRuns {
+    if
+      shouldDrawParentText,
+      let parentDrawRun = rowDrawRun.drawRuns.first(where: { $0.columnsRange.contains(origin.column) }),
+      let glyphRuns = parentDrawRun.glyphRuns
+    {
       context.clip(to: [rect])
 
-      context.setFillColor(cursorForegroundColor.cg)
+      context.setFillColor(cursorForegroundColor)
 
       let parentRectangle = IntegerRectangle(
-        origin: .init(column: parentOrigin.column, row: parentOrigin.row),
+        origin: .init(column: parentDrawRun.originColumn, row: origin.row),
         size: .init(
           columnsCount: parentDrawRun.columnsCount,
           rowsCount: 1
@@ -590,7 +849,6 @@ public struct CursorDrawRun: Sendable {
       let parentRect = (parentRectangle * font.cellSize)
         .applying(upsideDownTransform)
 
-      context.setAllowsAntialiasing(true)
       context.setShouldAntialias(true)
 
       for glyphRun in glyphRuns {
@@ -607,25 +865,3 @@ public struct CursorDrawRun: Sendable {
     }
   }
 }
-
-public final class GlobalDrawRunsCache: @unchecked Sendable {
-  public static let shared = GlobalDrawRunsCache()
-
-  private var dictionary = LockIsolated(OrderedDictionary<Int, DrawRun>())
-
-  public func drawRun(for key: Int) -> DrawRun? {
-    dictionary.withValue { dictionary in
-      dictionary[key]
-    }
-  }
-
-  public func store(_ drawRun: DrawRun, forKey key: Int) {
-    dictionary.withValue { dictionary in
-      dictionary.updateValue(drawRun, forKey: key)
-
-      if dictionary.count > 500 {
-        dictionary.removeFirst()
-      }
-    }
-  }
-}
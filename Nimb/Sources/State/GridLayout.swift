@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: MIT
 
 import AppKit
+import ConcurrencyExtras
 import Overture
 
 @PublicInit
@@ -23,155 +24,215 @@ public struct GridLayout: Sendable {
   init(cells: TwoDimensionalArray<Cell>) {
     self.cells = cells
     rowLayouts = cells.rows
-      .map(RowLayout.init(rowCells:))
+      .map { RowLayout(rowCells: $0) }
   }
-}
 
-@PublicInit
-public struct Cell: Sendable, Hashable {
-  public static let whitespace = Self(
-    character: " ",
-    isDoubleWidth: false,
-    highlightID: .zero
-  )
-
-  public var character: Character?
-  public var isDoubleWidth: Bool
-  public var highlightID: Highlight.ID
+  /// Rows with at least one part drawn with any of `highlightIDs`.
+  public func rows(usingHighlightIDs highlightIDs: Set<Highlight.ID>) -> [Int] {
+    guard !highlightIDs.isEmpty else {
+      return []
+    }
+    return rowLayouts.indices.filter { row in
+      rowLayouts[row].parts.contains { highlightIDs.contains($0.highlightID) }
+    }
+  }
 }
 
 @PublicInit
 public struct RowLayout: Sendable {
+  /// Process-wide unique stamp of the layout contents, renderers use it to memoize draw runs.
+  public typealias Revision = UInt64
+
+  private static let lastRevision = LockIsolated<Revision>(0)
+
   public var parts: [RowPart]
+  public var revision: Revision = RowLayout.makeRevision()
+
+  public static func makeRevision() -> Revision {
+    lastRevision.withValue { lastRevision in
+      lastRevision += 1
+      return lastRevision
+    }
+  }
 
-  public init(rowCells: [Cell]) {
+  public init(rowCells: some Sequence<Cell>) {
     var accumulator = RowPartsAccumulator()
     for cell in rowCells {
       accumulator.append(cell)
     }
     self.init(parts: accumulator.rowParts)
+  }
+
+  /// Re-segments only the parts overlapping `columns` and their direct neighbours after cells
+  /// in `columns` of the row were replaced, all other parts are kept as they are.
+  public mutating func splice(
+    rowCells: some RandomAccessCollection<Cell>,
+    changedColumns columns: Range<Int>
+  ) {
+    guard
+      !columns.isEmpty,
+      let firstOverlapping = parts.firstIndex(where: { $0.columnsRange.upperBound > columns.lowerBound }),
+      let lastOverlapping = parts.lastIndex(where: { $0.originColumn < columns.upperBound })
+    else {
+      return
+    }
 
-    struct RowPartsAccumulator {
-      private enum InternalPartContent {
-        case whitespaceCharacters(count: Int)
-        case doubleWidthCharacter(Character, isWithSecondFillerCharacter: Bool)
-        case singleWidthCharacters([Character])
+    let lowerPart = max(0, firstOverlapping - 1)
+    var upperPart = min(parts.count, lastOverlapping + 2)
+    let originColumn = parts[lowerPart].originColumn
+
+    while true {
+      let upperColumn = parts[upperPart - 1].columnsRange.upperBound
+
+      var accumulator = RowPartsAccumulator(originColumn: originColumn)
+      for cell in rowCells.dropFirst(originColumn).prefix(upperColumn - originColumn) {
+        accumulator.append(cell)
       }
 
-      private struct InternalPart {
-        var content: InternalPartContent
-        var highlightID: Highlight.ID
-        var originColumn: Int
+      // The last re-segmented part must not absorb the first cell of the next kept part,
+      // otherwise the boundary moved and that part has to be re-segmented too.
+      if upperPart < parts.count {
+        var probe = accumulator
+        probe.append(rowCells[rowCells.index(rowCells.startIndex, offsetBy: upperColumn)])
+        if probe.partsCount == accumulator.partsCount {
+          upperPart += 1
+          continue
+        }
       }
 
-      private var cellsCount = 0
-      private var internalParts: [InternalPart] = []
+      parts.replaceSubrange(lowerPart ..< upperPart, with: accumulator.rowParts)
+      revision = Self.makeRevision()
+      return
+    }
+  }
+}
 
-      mutating func append(_ cell: Cell) {
-        defer { cellsCount += 1 }
+private struct RowPartsAccumulator {
+  private enum InternalPartContent {
+    case whitespaceCharacters(count: Int)
+    case doubleWidthCharacter(String, isWithSecondFillerCharacter: Bool)
+    case singleWidthCharacters([String])
+  }
+
+  private struct InternalPart {
+    var content: InternalPartContent
+    var highlightID: Highlight.ID
+    var originColumn: Int
+  }
 
-        enum CellCharacterType {
-          case whitespace
-          case regular(Character, isDoubleWidth: Bool)
-          case missing
+  private var cellsCount: Int
+  private var internalParts: [InternalPart] = []
+
+  var partsCount: Int {
+    internalParts.count
+  }
+
+  init(originColumn: Int = 0) {
+    cellsCount = originColumn
+  }
+
+  mutating func append(_ cell: Cell) {
+    defer { cellsCount += 1 }
+
+    enum CellCharacterType {
+      case whitespace
+      case regular(String, isDoubleWidth: Bool)
+      case missing
+    }
+    let cellCharacterType: CellCharacterType =
+      if !cell.hasText {
+        .missing
+      } else if cell.isWhitespace {
+        .whitespace
+      } else {
+        .regular(cell.text!, isDoubleWidth: cell.isDoubleWidth)
+      }
+
+    if let lastPart = internalParts.last {
+      if lastPart.highlightID == cell.highlightID {
+        switch (lastPart.content, cellCharacterType) {
+        case let (.whitespaceCharacters(count), .whitespace):
+          internalParts[internalParts.count - 1].content = .whitespaceCharacters(
+            count: count + 1
+          )
+          return
+
+        case (.doubleWidthCharacter(let character, false), .missing):
+          internalParts[internalParts.count - 1].content = .doubleWidthCharacter(
+            character,
+            isWithSecondFillerCharacter: true
+          )
+          return
+
+        case (.singleWidthCharacters(var characters), .regular(let character, false)):
+          characters.append(character)
+          internalParts[internalParts.count - 1].content = .singleWidthCharacters(
+            characters
+          )
+          return
+
+        default:
+          break
         }
-        let cellCharacterType: CellCharacterType =
-          if let character = cell.character {
-            if character.isWhitespace {
-              .whitespace
-            } else {
-              .regular(character, isDoubleWidth: cell.isDoubleWidth)
-            }
-          } else {
-            .missing
-          }
+      }
+    }
 
-        if let lastPart = internalParts.last {
-          if lastPart.highlightID == cell.highlightID {
-            switch (lastPart.content, cellCharacterType) {
-            case let (.whitespaceCharacters(count), .whitespace):
-              internalParts[internalParts.count - 1].content = .whitespaceCharacters(
-                count: count + 1
-              )
-              return
-
-            case (.doubleWidthCharacter(let character, false), .missing):
-              internalParts[internalParts.count - 1].content = .doubleWidthCharacter(
-                character,
-                isWithSecondFillerCharacter: true
-              )
-              return
-
-            case (.singleWidthCharacters(var characters), .regular(let character, false)):
-              characters.append(character)
-              internalParts[internalParts.count - 1].content = .singleWidthCharacters(
-                characters
-              )
-              return
-
-            default:
-              break
-            }
-          }
+    let content: InternalPartContent =
+      switch cellCharacterType {
+      case .whitespace:
+        .whitespaceCharacters(count: 1)
+
+      case let .regular(character, isDoubleWidth):
+        if isDoubleWidth {
+          .doubleWidthCharacter(character, isWithSecondFillerCharacter: false)
+        } else {
+          .singleWidthCharacters([character])
         }
 
-        let content: InternalPartContent =
-          switch cellCharacterType {
-          case .whitespace:
-            .whitespaceCharacters(count: 1)
+      case .missing:
+        .whitespaceCharacters(count: 1)
+      }
+    internalParts.append(
+      .init(content: content, highlightID: cell.highlightID, originColumn: cellsCount)
+    )
+  }
 
-          case let .regular(character, isDoubleWidth):
-            if isDoubleWidth {
-              .doubleWidthCharacter(character, isWithSecondFillerCharacter: false)
+  var rowParts: [RowPart] {
+    internalParts
+      .map { internalPart in
+        let content: RowPartContent =
+          switch internalPart.content {
+          case let .whitespaceCharacters(count):
+            .whitespace(columnsCount: count)
+
+          case let .doubleWidthCharacter(character, isWithSecondFillerCharacter):
+            if isWithSecondFillerCharacter {
+              .cells([
+                .init(text: character, isDoubleWidth: true),
+                .init(text: " ", isDoubleWidth: false),
+              ])
             } else {
-              .singleWidthCharacters([character])
+              .cells([
+                .init(text: character, isDoubleWidth: true),
+              ])
             }
 
-          case .missing:
-            .whitespaceCharacters(count: 1)
+          case let .singleWidthCharacters(characters):
+            .cells(characters.map { .init(text: $0, isDoubleWidth: false) })
           }
-        internalParts.append(
-          .init(content: content, highlightID: cell.highlightID, originColumn: cellsCount)
+        return RowPart(
+          content: content,
+          highlightID: internalPart.highlightID,
+          originColumn: internalPart.originColumn
         )
       }
-
-      var rowParts: [RowPart] {
-        internalParts
-          .map { internalPart in
-            let content: RowPartContent =
-              switch internalPart.content {
-              case let .whitespaceCharacters(count):
-                .whitespace(columnsCount: count)
-
-              case let .doubleWidthCharacter(character, isWithSecondFillerCharacter):
-                if isWithSecondFillerCharacter {
-                  .cells([
-                    .init(character: character, isDoubleWidth: true),
-                    .init(character: " ", isDoubleWidth: false),
-                  ])
-                } else {
-                  .cells([
-                    .init(character: character, isDoubleWidth: true),
-                  ])
-                }
-
-              case let .singleWidthCharacters(characters):
-                .cells(characters.map { .init(character: $0, isDoubleWidth: false) })
-              }
-            return RowPart(
-              content: content,
-              highlightID: internalPart.highlightID,
-              originColumn: internalPart.originColumn
-            )
-          }
-      }
-    }
   }
 }
 
 @PublicInit
 public struct RowPartCell: Sendable, Hashable {
-  public var character: Character
+  /// Single grapheme cluster in practice, but whatever text Neovim sent for the cell.
+  public var text: String
   public var isDoubleWidth: Bool
 }
 
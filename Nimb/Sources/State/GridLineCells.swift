@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: MIT
+
+/// Cells of a single `grid_line` UI event, expanded from its `[text, hl_id?, repeat?]` triplets.
+///
+/// Malformed triplets are skipped and collected in `invalidCells`, so one bad cell is reported
+/// without failing the whole redraw batch.
+@PublicInit
+public struct GridLineCells: Sendable, Hashable {
+  @PublicInit
+  public struct InvalidCell: Sendable, Hashable {
+    public var reason: String
+    public var value: Value
+  }
+
+  public var cells: [Cell]
+  public var invalidCells: [InvalidCell] = []
+
+  public var value: Value {
+    .array(cells.map { cell in
+      .array([
+        .string(cell.text ?? ""),
+        .integer(cell.highlightID),
+      ])
+    })
+  }
+
+  public init?(_ value: Value) {
+    guard case let .array(rawCells) = value else {
+      return nil
+    }
+    var accumulator = Accumulator(capacity: rawCells.count)
+
+    for rawCellValue in rawCells {
+      guard
+        case let .array(rawCell) = rawCellValue,
+        !rawCell.isEmpty,
+        case let .string(text) = rawCell[0]
+      else {
+        accumulator.reject("invalid grid line cell value", rawCellValue)
+        continue
+      }
+
+      var highlightID: Int?
+      var repeatCount = 1
+
+      if rawCell.count > 1 {
+        guard
+          case let .integer(newHighlightID) = rawCell[1],
+          Cell.highlightIDRange.contains(newHighlightID)
+        else {
+          accumulator.reject("invalid grid line cell highlight value", rawCellValue)
+          continue
+        }
+        highlightID = newHighlightID
+
+        if rawCell.count > 2 {
+          guard case let .integer(newRepeatCount) = rawCell[2], newRepeatCount >= 0 else {
+            accumulator.reject("invalid grid line cell repeat count value", rawCellValue)
+            continue
+          }
+          repeatCount = newRepeatCount
+        }
+      }
+
+      if text.count > 1 {
+        accumulator.reject("grid line cell text has more than one character", rawCellValue)
+      }
+      accumulator.append(
+        Cell(text: text, highlightID: .zero),
+        highlightID: highlightID,
+        repeatCount: repeatCount
+      )
+    }
+
+    self.init(cells: accumulator.cells, invalidCells: accumulator.invalidCells)
+  }
+
+  /// Decodes cells directly from the unpacker buffer.
+  ///
+  /// ASCII texts are packed into cells straight from the buffer, only multi scalar
+  /// grapheme clusters go through the shared cluster table. Invalid cells are materialized
+  /// as `Value` for reporting.
+  public init?(_ view: ValueView) {
+    guard let rawCells = view.array else {
+      return nil
+    }
+    var accumulator = Accumulator(capacity: rawCells.count)
+
+    for rawCellView in rawCells {
+      guard
+        let rawCell = rawCellView.array,
+        !rawCell.isEmpty,
+        let cell = rawCell[0].withUnsafeStringBytes({ Cell(utf8: $0, highlightID: .zero) })
+      else {
+        accumulator.reject("invalid grid line cell value", Value(rawCellView))
+        continue
+      }
+
+      var highlightID: Int?
+      var repeatCount = 1
+
+      if rawCell.count > 1 {
+        guard
+          let newHighlightID = rawCell[1].integer,
+          Cell.highlightIDRange.contains(newHighlightID)
+        else {
+          accumulator.reject("invalid grid line cell highlight value", Value(rawCellView))
+          continue
+        }
+        highlightID = newHighlightID
+
+        if rawCell.count > 2 {
+          guard let newRepeatCount = rawCell[2].integer, newRepeatCount >= 0 else {
+            accumulator.reject("invalid grid line cell repeat count value", Value(rawCellView))
+            continue
+          }
+          repeatCount = newRepeatCount
+        }
+      }
+
+      if cell.isCluster, let text = cell.text, text.count > 1 {
+        accumulator.reject("grid line cell text has more than one character", Value(rawCellView))
+      }
+      accumulator.append(
+        cell,
+        highlightID: highlightID,
+        repeatCount: repeatCount
+      )
+    }
+
+    self.init(cells: accumulator.cells, invalidCells: accumulator.invalidCells)
+  }
+
+  private struct Accumulator {
+    var cells = [Cell]()
+    var highlightID = Highlight.defaultID
+    var invalidCells = [InvalidCell]()
+
+    init(capacity: Int) {
+      cells.reserveCapacity(capacity)
+    }
+
+    mutating func append(
+      _ cell: Cell,
+      highlightID newHighlightID: Int?,
+      repeatCount: Int
+    ) {
+      if let newHighlightID {
+        highlightID = newHighlightID
+      }
+
+      if !cell.hasText, !cells.isEmpty {
+        cells[cells.count - 1].isDoubleWidth = true
+      }
+
+      var cell = cell
+      cell.highlightID = highlightID
+      cells.append(contentsOf: repeatElement(cell, count: repeatCount))
+    }
+
+    mutating func reject(_ reason: String, _ value: Value) {
+      invalidCells.append(.init(reason: reason, value: value))
+    }
+  }
+}
@@ -1,7 +1,7 @@
 // SPDX-License-Identifier: MIT
 
 @PublicInit
-public struct Highlight: Identifiable, Sendable {
+public struct Highlight: Identifiable, Equatable, Sendable {
   @PublicInit
   public struct Decorations: Hashable, Sendable {
     public var isStrikethrough: Bool = false
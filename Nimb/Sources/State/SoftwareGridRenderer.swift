@@ -0,0 +1,638 @@
+// SPDX-License-Identifier: MIT
+
+import AppKit
+
+/// Provides coverage masks of glyphs for `SoftwareGridRenderer`.
+public protocol GlyphBitmapSource: AnyObject {
+  /// `subpixelOffset` moves the glyph right and down by a fraction of a pixel, so glyphs at fractional
+  /// positions keep them like CoreGraphics does.
+  func alphaMask(
+    for glyph: CGGlyph,
+    in glyphRun: GlyphRun,
+    scale: Double,
+    subpixelOffset: CGPoint
+  )
+    -> AlphaMask?
+}
+
+/// Rasterizes every glyph once with CoreGraphics and memoizes its mask.
+public final class CoreGraphicsGlyphBitmapSource: GlyphBitmapSource {
+  private struct Key: Hashable {
+    var fontName: String
+    var pointSize: Double
+    var glyph: CGGlyph
+    var textMatrix: [Double]
+    var scale: Double
+    var subpixelOffsetX: Double
+    var subpixelOffsetY: Double
+  }
+
+  private var alphaMasks = [Key: AlphaMask?]()
+
+  public init() { }
+
+  public func alphaMask(
+    for glyph: CGGlyph,
+    in glyphRun: GlyphRun,
+    scale: Double,
+    subpixelOffset: CGPoint
+  )
+    -> AlphaMask?
+  {
+    let textMatrix = glyphRun.textMatrix
+    let key = Key(
+      fontName: glyphRun.appKitFont.fontName,
+      pointSize: glyphRun.appKitFont.pointSize,
+      glyph: glyph,
+      textMatrix: [textMatrix.a, textMatrix.b, textMatrix.c, textMatrix.d],
+      scale: scale,
+      subpixelOffsetX: subpixelOffset.x,
+      subpixelOffsetY: subpixelOffset.y
+    )
+    if let alphaMask = alphaMasks[key] {
+      return alphaMask
+    }
+    let alphaMask = Self.makeAlphaMask(
+      for: glyph,
+      appKitFont: glyphRun.appKitFont,
+      textMatrix: textMatrix,
+      scale: scale,
+      subpixelOffset: subpixelOffset
+    )
+    alphaMasks[key] = alphaMask
+    return alphaMask
+  }
+
+  private static func makeAlphaMask(
+    for glyph: CGGlyph,
+    appKitFont: NSFont,
+    textMatrix: CGAffineTransform,
+    scale: Double,
+    subpixelOffset: CGPoint
+  )
+    -> AlphaMask?
+  {
+    var glyph = glyph
+    var boundingRect = CGRect()
+    CTFontGetBoundingRectsForGlyphs(appKitFont, .horizontal, &glyph, &boundingRect, 1)
+    // Pixel space of the mask has y growing upwards, unlike the pixel buffer.
+    boundingRect = boundingRect
+      .applying(textMatrix)
+      .applying(.init(scaleX: scale, y: scale))
+      .offsetBy(dx: subpixelOffset.x, dy: -subpixelOffset.y)
+    guard !boundingRect.isEmpty else {
+      return nil
+    }
+
+    // One pixel of padding on every side keeps antialiased edges.
+    let left = Int(boundingRect.minX.rounded(.down)) - 1
+    let bottom = Int(boundingRect.minY.rounded(.down)) - 1
+    let width = Int(boundingRect.maxX.rounded(.up)) + 1 - left
+    let height = Int(boundingRect.maxY.rounded(.up)) + 1 - bottom
+
+    guard
+      let context = CGContext(
+        data: nil,
+        width: width,
+        height: height,
+        bitsPerComponent: 8,
+        bytesPerRow: 0,
+        space: CGColorSpaceCreateDeviceGray(),
+        bitmapInfo: CGImageAlphaInfo.none.rawValue
+      ),
+      let data = context.data
+    else {
+      return nil
+    }
+    context.translateBy(x: -Double(left) + subpixelOffset.x, y: -Double(bottom) - subpixelOffset.y)
+    context.scaleBy(x: scale, y: scale)
+    context.textMatrix = textMatrix
+    context.setFillColor(gray: 1, alpha: 1)
+    var position = CGPoint.zero
+    CTFontDrawGlyphs(appKitFont, &glyph, &position, 1, context)
+
+    // Bitmap context memory starts with the top row.
+    let bytes = data.bindMemory(to: UInt8.self, capacity: context.bytesPerRow * height)
+    var coverage = [UInt8]()
+    coverage.reserveCapacity(width * height)
+    for row in 0 ..< height {
+      coverage.append(contentsOf: UnsafeBufferPointer(start: bytes + row * context.bytesPerRow, count: width))
+    }
+
+    return .init(
+      width: width,
+      height: height,
+      left: left,
+      top: -(bottom + height),
+      coverage: coverage
+    )
+  }
+}
+
+/// Draws a grid into a `PixelBuffer` on the CPU, for benchmarking and comparing rendering without
+/// a `CALayer`.
+///
+/// Geometry follows `GridLayer`: cells span `column * cellWidth` and `row * cellHeight` points,
+/// with edges scaled and rounded to whole pixels as CoreGraphics fills them with antialiasing
+/// disabled, and decorations and cursor shapes use the same offsets. Glyphs are placed at quarter
+/// pixel precision, so they may sit up to an eighth of a pixel away from where CoreGraphics puts
+/// them. `compareWithCoreGraphics` measures how far the output is from the CoreGraphics path.
+/// Dirty rectangles are widened the way `GridLayer` widens them, so glyph overhangs are redrawn too.
+///
+/// Draw runs and glyph masks still come from CoreText, so the renderer needs AppKit; only
+/// `PixelBuffer` is platform independent.
+public final class SoftwareGridRenderer {
+  /// Glyph positions are rounded to this fraction of a pixel, each step gets its own masks.
+  public static let subpixelStepsCount = 4
+
+  public private(set) var pixelBuffer = PixelBuffer(width: 0, height: 0)
+  public let scale: Double
+
+  private let glyphBitmapSource: any GlyphBitmapSource
+  private let drawRuns: GridDrawRuns
+  private var needsDisplay = true
+  private var invalidatedRows = [Int]()
+
+  public init(
+    glyphBitmapSource: any GlyphBitmapSource = CoreGraphicsGlyphBitmapSource(),
+    drawRuns: GridDrawRuns = .init(),
+    scale: Double = 1
+  ) {
+    self.glyphBitmapSource = glyphBitmapSource
+    self.drawRuns = drawRuns
+    self.scale = scale
+  }
+
+  /// Call when font or appearance changed, the next render redraws everything.
+  public func invalidate() {
+    drawRuns.removeAll()
+    needsDisplay = true
+  }
+
+  /// Call when highlights used by `rows` were redefined, the next render shapes and redraws only them.
+  public func invalidate(rows: [Int], layout: GridLayout) {
+    drawRuns.remove(revisions: Set(rows.map { layout.rowLayouts[$0].revision }))
+    invalidatedRows += rows
+  }
+
+  /// Redraws cells in `dirtyRectangles` and invalidated rows, or the whole grid when it is `nil`,
+  /// the pixel size changed or `invalidate()` was called.
+  public func render(
+    grid: Grid,
+    dirtyRectangles: [IntegerRectangle]?,
+    font: Font,
+    appearance: Appearance,
+    isCursorVisible: Bool = true
+  ) {
+    let gridFrame = IntegerRectangle(size: grid.size) * font.cellSize
+    let width = pixel(gridFrame.maxX)
+    let height = pixel(gridFrame.maxY)
+    if pixelBuffer.width != width || pixelBuffer.height != height {
+      pixelBuffer = .init(width: width, height: height)
+      needsDisplay = true
+    }
+    drawRuns.removeUnused(for: grid.layout)
+
+    let invalidatedRectangles = invalidatedRows.map { row in
+      IntegerRectangle(
+        origin: .init(column: 0, row: row),
+        size: .init(columnsCount: grid.columnsCount, rowsCount: 1)
+      )
+    }
+    let frames =
+      if !needsDisplay, let dirtyRectangles {
+        (dirtyRectangles + invalidatedRectangles).map { rectangle in
+          (rectangle * font.cellSize)
+            .insetBy(dx: -font.cellWidth, dy: -font.cellHeight * 0.5)
+        }
+      } else {
+        [gridFrame]
+      }
+    needsDisplay = false
+    invalidatedRows.removeAll(keepingCapacity: true)
+
+    for frame in frames {
+      draw(
+        frame: frame,
+        grid: grid,
+        font: font,
+        appearance: appearance,
+        isCursorVisible: isCursorVisible
+      )
+    }
+    pixelBuffer.clipRectangle = nil
+  }
+
+  private func draw(
+    frame: CGRect,
+    grid: Grid,
+    font: Font,
+    appearance: Appearance,
+    isCursorVisible: Bool
+  ) {
+    let clipRectangle = pixelRectangle(frame)
+    pixelBuffer.clipRectangle = clipRectangle
+
+    let boundingRect = IntegerRectangle(frame: frame, cellSize: font.cellSize)
+      .intersection(with: .init(size: grid.size))
+    guard boundingRect.size.rowsCount > 0, boundingRect.size.columnsCount > 0 else {
+      return
+    }
+    drawRuns.prepareRows(
+      boundingRect.rows,
+      layout: grid.layout,
+      font: font,
+      appearance: appearance
+    )
+
+    for row in boundingRect.rows {
+      let rowDrawRun = drawRuns.rowDrawRun(forRow: row, layout: grid.layout, font: font, appearance: appearance)
+      for drawRun in rowDrawRun.drawRuns where drawRun.columnsRange.overlaps(boundingRect.columns) {
+        pixelBuffer.fill(
+          pixelRectangle(runFrame(drawRun, row: row, font: font)),
+          color: appearance.style(for: drawRun.highlightID).backgroundColor.pixel
+        )
+      }
+    }
+
+    for row in boundingRect.rows {
+      let rowDrawRun = drawRuns.rowDrawRun(forRow: row, layout: grid.layout, font: font, appearance: appearance)
+      for drawRun in rowDrawRun.drawRuns where drawRun.columnsRange.overlaps(boundingRect.columns) {
+        drawForeground(drawRun, row: row, font: font, appearance: appearance)
+      }
+    }
+
+    if
+      isCursorVisible,
+      let cursorDrawRun = grid.cursorDrawRun,
+      boundingRect.contains(cursorDrawRun.origin)
+    {
+      drawCursor(
+        cursorDrawRun,
+        rowDrawRun: drawRuns.rowDrawRun(
+          forRow: cursorDrawRun.origin.row,
+          layout: grid.layout,
+          font: font,
+          appearance: appearance
+        ),
+        font: font,
+        appearance: appearance
+      )
+      pixelBuffer.clipRectangle = clipRectangle
+    }
+  }
+
+  private func drawForeground(
+    _ drawRun: DrawRun,
+    row: Int,
+    font: Font,
+    appearance: Appearance
+  ) {
+    guard case let .cells(cells) = drawRun.rowPartContent, let glyphRuns = drawRun.glyphRuns else {
+      return
+    }
+    let style = appearance.style(for: drawRun.highlightID)
+    let decorations = style.decorations
+    let specialColor = style.specialColor.pixel
+    let frame = runFrame(drawRun, row: row, font: font)
+
+    if decorations.isStrikethrough {
+      drawHorizontalLine(frame.minX ..< frame.maxX, centerY: frame.midY, color: specialColor)
+    }
+
+    let underlineY = frame.maxY - 0.5
+
+    if decorations.isUnderline || decorations.isUnderdashed || decorations.isUnderdotted {
+      let dash: (on: Double, off: Double)? =
+        if decorations.isUnderdashed {
+          (2, 2)
+        } else if decorations.isUnderdotted {
+          (1, 1)
+        } else {
+          nil
+        }
+      drawHorizontalLine(frame.minX ..< frame.maxX, centerY: underlineY, color: specialColor, dash: dash)
+
+    } else if decorations.isUnderdouble {
+      drawHorizontalLine(frame.minX ..< frame.maxX, centerY: underlineY, color: specialColor)
+      drawHorizontalLine(frame.minX ..< frame.maxX, centerY: underlineY - 3, color: specialColor)
+
+    } else if decorations.isUndercurl {
+      let widthDivider = 3
+      let xStep = font.cellWidth / Double(widthDivider)
+      let pointsCount = cells.count * widthDivider + 1
+
+      var previousPoint = (x: frame.minX * scale, y: underlineY * scale)
+      for index in 1 ..< pointsCount {
+        let point = (
+          x: (frame.minX + Double(index) * xStep) * scale,
+          y: (index.isMultiple(of: 2) ? underlineY : underlineY - 3) * scale
+        )
+        pixelBuffer.drawLine(from: previousPoint, to: point, color: specialColor)
+        previousPoint = point
+      }
+    }
+
+    drawGlyphs(glyphRuns, in: frame, color: style.foregroundColor.pixel)
+  }
+
+  private func drawCursor(
+    _ cursorDrawRun: CursorDrawRun,
+    rowDrawRun: RowDrawRun,
+    font: Font,
+    appearance: Appearance
+  ) {
+    let cursorForegroundColor: PixelBuffer.Pixel
+    let cursorBackgroundColor: PixelBuffer.Pixel
+
+    if cursorDrawRun.highlightID == .zero {
+      cursorForegroundColor = appearance.defaultStyle.backgroundColor.pixel
+      cursorBackgroundColor = appearance.defaultStyle.foregroundColor.pixel
+
+    } else {
+      let style = appearance.style(for: cursorDrawRun.highlightID)
+      cursorForegroundColor = style.foregroundColor.pixel
+      cursorBackgroundColor = style.backgroundColor.pixel
+    }
+
+    let offset = cursorDrawRun.origin * font.cellSize
+    let cursorRectangle = pixelRectangle(
+      cursorDrawRun.cellFrame.offsetBy(dx: offset.x, dy: offset.y)
+    )
+    pixelBuffer.fill(cursorRectangle, color: cursorBackgroundColor)
+
+    if
+      cursorDrawRun.shouldDrawParentText,
+      let parentDrawRun = rowDrawRun.drawRuns.first(where: { $0.columnsRange.contains(cursorDrawRun.origin.column) }),
+      let glyphRuns = parentDrawRun.glyphRuns
+    {
+      pixelBuffer.clipRectangle = cursorRectangle
+        .intersection(with: pixelBuffer.clipRectangle ?? pixelBuffer.bounds)
+      drawGlyphs(
+        glyphRuns,
+        in: runFrame(parentDrawRun, row: cursorDrawRun.origin.row, font: font),
+        color: cursorForegroundColor
+      )
+    }
+  }
+
+  /// Glyph positions are relative to the bottom left corner of the run, y growing upwards.
+  private func drawGlyphs(_ glyphRuns: [GlyphRun], in frame: CGRect, color: PixelBuffer.Pixel) {
+    for glyphRun in glyphRuns {
+      for (glyph, position) in zip(glyphRun.glyphs, glyphRun.positions) {
+        let x = subpixel(frame.minX + position.x)
+        let y = subpixel(frame.maxY - position.y)
+        guard
+          let alphaMask = glyphBitmapSource.alphaMask(
+            for: glyph,
+            in: glyphRun,
+            scale: scale,
+            subpixelOffset: .init(x: x.fraction, y: y.fraction)
+          )
+        else {
+          continue
+        }
+        pixelBuffer.blend(alphaMask, x: x.pixel, y: y.pixel, color: color)
+      }
+    }
+  }
+
+  /// One point wide line like a stroked CoreGraphics path, optionally dashed with lengths in points.
+  private func drawHorizontalLine(
+    _ xRange: Range<Double>,
+    centerY: Double,
+    color: PixelBuffer.Pixel,
+    dash: (on: Double, off: Double)? = nil
+  ) {
+    let yRange = pixel(centerY - 0.5) ..< pixel(centerY + 0.5)
+    guard let dash else {
+      pixelBuffer.fill(
+        .init(x: pixel(xRange.lowerBound) ..< pixel(xRange.upperBound), y: yRange),
+        color: color
+      )
+      return
+    }
+    // Matches the dash phase of half a point used by `DrawRun.drawForeground`.
+    for start in stride(from: xRange.lowerBound - 0.5, to: xRange.upperBound, by: dash.on + dash.off) {
+      let segment = max(start, xRange.lowerBound) ..< min(start + dash.on, xRange.upperBound)
+      pixelBuffer.fill(
+        .init(x: pixel(segment.lowerBound) ..< pixel(segment.upperBound), y: yRange),
+        color: color
+      )
+    }
+  }
+
+  private func runFrame(_ drawRun: DrawRun, row: Int, font: Font) -> CGRect {
+    .init(
+      x: Double(drawRun.columnsRange.lowerBound) * font.cellWidth,
+      y: Double(row) * font.cellHeight,
+      width: Double(drawRun.columnsRange.count) * font.cellWidth,
+      height: font.cellHeight
+    )
+  }
+
+  private func pixelRectangle(_ frame: CGRect) -> PixelBuffer.Rectangle {
+    .init(
+      x: pixel(frame.minX) ..< max(pixel(frame.minX), pixel(frame.maxX)),
+      y: pixel(frame.minY) ..< max(pixel(frame.minY), pixel(frame.maxY))
+    )
+  }
+
+  private func pixel(_ coordinate: Double) -> Int {
+    Int((coordinate * scale).rounded())
+  }
+
+  /// Splits a coordinate into a whole pixel and a fraction rounded to `subpixelStepsCount` steps.
+  private func subpixel(_ coordinate: Double) -> (pixel: Int, fraction: Double) {
+    let stepsCount = Self.subpixelStepsCount
+    let steps = Int((coordinate * scale * Double(stepsCount)).rounded())
+    let pixel = steps >= 0 ? steps / stepsCount : -((-steps + stepsCount - 1) / stepsCount)
+    return (pixel, Double(steps - pixel * stepsCount) / Double(stepsCount))
+  }
+}
+
+public extension SoftwareGridRenderer {
+  @PublicInit
+  struct Benchmark: Sendable {
+    public var framesCount: Int
+    public var renderedGridsCount: Int
+    public var duration: Duration
+    /// Of the final state of every visible grid, see `compareWithCoreGraphics`.
+    public var coreGraphicsDifference = PixelBuffer.Difference()
+
+    public var framesPerSecond: Double {
+      let seconds = Double(duration.components.seconds) + Double(duration.components.attoseconds) / 1e18
+      return seconds == 0 ? 0 : Double(framesCount) / seconds
+    }
+  }
+
+  /// Replays `redraw` notifications of a recorded msgpack stream through the reducer and renders
+  /// the dirty rectangles of every grid at each flush, like the store publishes state. Only rendering is timed. The final state
+  /// of every visible grid is then compared with its CoreGraphics rasterization.
+  static func measure(redrawStream data: Data, font: Font, scale: Double = 1) throws -> Benchmark {
+    var state = State(font: font)
+    var renderers = [Grid.ID: SoftwareGridRenderer]()
+    var benchmark = Benchmark(framesCount: 0, renderedGridsCount: 0, duration: .zero)
+    var updates = State.Updates()
+    let clock = ContinuousClock()
+
+    for value in try Unpacker().unpack(data) {
+      guard
+        case let .notification(notification) = try Message(value: value),
+        notification.method == "redraw"
+      else {
+        continue
+      }
+      let uiEvents = try [UIEvent](rawRedrawNotificationParameters: notification.parameters)
+      updates.formUnion(
+        Actions.ApplyUIEvents(uiEvents: uiEvents)
+          .apply(to: &state, handleError: { _ in })
+      )
+      guard updates.needFlush else {
+        continue
+      }
+      state.materializePendingLines()
+      defer { updates = .init() }
+
+      for gridID in updates.destroyedGridIDs {
+        renderers.removeValue(forKey: gridID)
+      }
+
+      let duration = clock.measure {
+        for (gridID, grid) in state.grids where !grid.isHidden {
+          let renderer = renderers[gridID] ?? SoftwareGridRenderer(scale: scale)
+          renderers[gridID] = renderer
+
+          if updates.isFontUpdated || updates.isAppearanceUpdated {
+            renderer.invalidate()
+          } else {
+            renderer.invalidate(
+              rows: grid.layout.rows(usingHighlightIDs: updates.redefinedHighlightIDs),
+              layout: grid.layout
+            )
+          }
+          let dirtyRectangles: [IntegerRectangle]?
+          switch updates.gridUpdates[gridID] {
+          case let .dirtyRectangles(value):
+            dirtyRectangles = value
+
+          case .needsDisplay:
+            dirtyRectangles = nil
+
+          case nil:
+            if renderer.needsDisplay {
+              dirtyRectangles = nil
+            } else if !renderer.invalidatedRows.isEmpty {
+              dirtyRectangles = []
+            } else {
+              continue
+            }
+          }
+
+          renderer.render(
+            grid: grid,
+            dirtyRectangles: dirtyRectangles,
+            font: state.font,
+            appearance: state.appearance
+          )
+          benchmark.renderedGridsCount += 1
+        }
+      }
+      benchmark.framesCount += 1
+      benchmark.duration += duration
+    }
+
+    state.materializePendingLines()
+    for grid in state.grids.values where !grid.isHidden {
+      if
+        let difference = compareWithCoreGraphics(
+          grid: grid,
+          font: state.font,
+          appearance: state.appearance,
+          scale: scale
+        )
+      {
+        benchmark.coreGraphicsDifference.formUnion(difference)
+      }
+    }
+
+    return benchmark
+  }
+
+  /// Renders `grid` without the cursor both in software and with `GridDrawRuns.draw`, which `GridLayer`
+  /// rasterizes its tiles with, and compares the results. Cell edges and decorations should match
+  /// exactly, `tolerance` absorbs antialiasing differences at glyph edges.
+  static func compareWithCoreGraphics(
+    grid: Grid,
+    font: Font,
+    appearance: Appearance,
+    scale: Double = 1,
+    tolerance: UInt8 = 48
+  )
+    -> PixelBuffer.Difference?
+  {
+    let renderer = SoftwareGridRenderer(scale: scale)
+    renderer.render(
+      grid: grid,
+      dirtyRectangles: nil,
+      font: font,
+      appearance: appearance,
+      isCursorVisible: false
+    )
+    let softwarePixelBuffer = renderer.pixelBuffer
+    let width = softwarePixelBuffer.width
+    let height = softwarePixelBuffer.height
+
+    guard
+      width > 0, height > 0,
+      let context = CGContext(
+        data: nil,
+        width: width,
+        height: height,
+        bitsPerComponent: 8,
+        bytesPerRow: width * MemoryLayout<PixelBuffer.Pixel>.stride,
+        space: CGColorSpaceCreateDeviceRGB(),
+        bitmapInfo: CGImageAlphaInfo.premultipliedLast.rawValue
+      ),
+      let data = context.data
+    else {
+      return nil
+    }
+    // Same opaque black a new pixel buffer starts with.
+    context.setFillColor(Color.black.cg)
+    context.fill(CGRect(x: 0, y: 0, width: width, height: height))
+    context.scaleBy(x: scale, y: scale)
+
+    let gridRectangle = IntegerRectangle(size: grid.size)
+    GridDrawRuns().draw(
+      to: context,
+      layout: grid.layout,
+      backgroundRect: gridRectangle,
+      foregroundRect: gridRectangle,
+      font: font,
+      appearance: appearance,
+      clearedBackgroundColor: nil,
+      upsideDownTransform: .init(scaleX: 1, y: -1)
+        .translatedBy(x: 0, y: -Double(grid.rowsCount) * font.cellHeight)
+    )
+
+    // Bitmap context memory starts with the top row, like pixel buffers.
+    let pixels = UnsafeBufferPointer(
+      start: data.bindMemory(to: PixelBuffer.Pixel.self, capacity: width * height),
+      count: width * height
+    )
+    let coreGraphicsPixelBuffer = PixelBuffer(width: width, height: height, pixels: Array(pixels))
+    return softwarePixelBuffer.difference(from: coreGraphicsPixelBuffer, tolerance: tolerance)
+  }
+}
+
+private extension Color {
+  var pixel: PixelBuffer.Pixel {
+    .init(
+      UInt8((rgb >> 16) & 0xFF),
+      UInt8((rgb >> 8) & 0xFF),
+      UInt8(rgb & 0xFF),
+      UInt8((alpha * 255).rounded())
+    )
+  }
+}
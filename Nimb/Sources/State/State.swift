@@ -16,6 +16,18 @@ public struct State: Sendable {
     public var isStoreActionsLoggingEnabled: Bool = false
   }
 
+  @PublicInit
+  public struct LineUpdatesStatistics: Sendable {
+    /// Number of `grid_line` events applied.
+    public var linesCount: Int = 0
+    /// Number of `grid_line` events that hit a row already waiting for a rebuild.
+    public var coalescedLinesCount: Int = 0
+
+    public var rowRebuildsCount: Int {
+      linesCount - coalescedLinesCount
+    }
+  }
+
   @PublicInit
   public struct Updates: Sendable {
     public var needFlush: Bool = false
@@ -29,6 +41,8 @@ public struct State: Sendable {
       Appearance
         .ObservedHighlightName
     > = []
+    /// Highlights that were already defined and changed. New IDs are not included, no cell can use them yet.
+    public var redefinedHighlightIDs: Set<Highlight.ID> = []
     public var isCursorUpdated: Bool = false
     public var tabline: TablineUpdate = .init()
     public var isCmdlinesUpdated: Bool = false
@@ -64,6 +78,7 @@ public struct State: Sendable {
       isAppearanceUpdated = isAppearanceUpdated || updates.isAppearanceUpdated
       updatedObservedHighlightNames
         .formUnion(updates.updatedObservedHighlightNames)
+      redefinedHighlightIDs.formUnion(updates.redefinedHighlightIDs)
       isCursorUpdated = isCursorUpdated || updates.isCursorUpdated
       tabline.formUnion(updates.tabline)
       isCmdlinesUpdated = isCmdlinesUpdated || updates.isCmdlinesUpdated
@@ -130,6 +145,7 @@ public struct State: Sendable {
   }
 
   public var debug: Debug = .init()
+  public var lineUpdatesStatistics: LineUpdatesStatistics = .init()
   public var rawOptions: OrderedDictionary<String, Value> = [:]
   public var title: String? = nil
   public var font: Font
@@ -190,9 +206,15 @@ public struct State: Sendable {
     return false
   }
 
-  public mutating func flushDrawRuns() {
+  public mutating func materializePendingLines() {
+    for gridID in grids.keys where !grids[gridID]!.pendingLineColumns.isEmpty {
+      grids[gridID]!.materializePendingLines()
+    }
+  }
+
+  public mutating func updateCursorDrawRuns() {
     for gridID in grids.keys {
-      grids[gridID]!.flushDrawRuns(font: font, appearance: appearance)
+      grids[gridID]!.updateCursorDrawRun(font: font)
     }
   }
 
@@ -212,7 +234,11 @@ public struct State: Sendable {
     if updates.isFontUpdated {
       font = state.font
     }
-    if updates.isAppearanceUpdated || !updates.updatedObservedHighlightNames.isEmpty {
+    if
+      updates.isAppearanceUpdated
+      || !updates.updatedObservedHighlightNames.isEmpty
+      || !updates.redefinedHighlightIDs.isEmpty
+    {
       appearance = state.appearance
     }
     if updates.isCursorUpdated {
@@ -41,21 +41,50 @@ public final class Store: Sendable {
   //      }
   //    }
 
-  private let actionsContinuation: AsyncStream<Action>.Continuation
-  private let alertsContinuation: AsyncStream<Alert>.Continuation
+  /// Time spent applying action batches on the state reduction thread.
+  public var reductionTimings: StageTimings {
+    reductionStage.timings
+  }
 
+  private let reductionStage: PipelineStage<[Action]>
+  private let alertsContinuation: AsyncStream<Alert>.Continuation
+  private let stopReading: @Sendable () -> Void
+
+  /// Runs as a pipeline: neovim output is decoded on the channel reading thread, action batches are reduced
+  /// into `State` on a dedicated thread, and flushed state is handed over to rendering through `updates`.
+  /// Decoding of the next batch overlaps with reduction of the previous one, and the bounded reduction
+  /// input throttles decoding when reduction falls behind.
+  ///
+  /// `updates` itself is unbounded: it carries incremental `State.Updates`, which cannot be dropped,
+  /// and its consumer only merges them into `FrameScheduler`, which keeps at most one pending frame.
   public init(api: API<ProcessChannel>, initialState: State) {
     self.api = api
 
-    let actions: AsyncStream<Action>
-    (actions, actionsContinuation) = AsyncStream.makeStream()
-
     (alerts, alertsContinuation) = AsyncStream.makeStream()
 
-    let applyUIEventsActions = api.neovimNotifications
-      .compactMap { [
-        alertsContinuation
-      ] neovimNotificationsBatch in
+    let updatesContinuation: AsyncStream<(state: State, updates: State.Updates)>.Continuation
+    (updates, updatesContinuation) = AsyncStream.makeStream()
+    updatesContinuation.yield((initialState, .init()))
+
+    let reducer = Reducer(
+      state: initialState,
+      updatesContinuation: updatesContinuation,
+      alertsContinuation: alertsContinuation
+    )
+    let reductionStage = PipelineStage<[Action]>(
+      name: "Store.reduction",
+      capacity: 8,
+      body: { actions in
+        reducer.apply(actions)
+      },
+      onFinish: {
+        updatesContinuation.finish()
+      }
+    )
+    self.reductionStage = reductionStage
+
+    stopReading = api.readNeovimNotifications(
+      onBatch: { [alertsContinuation] neovimNotificationsBatch in
         var actionsAccumulator = [Action]()
 
         for notification in neovimNotificationsBatch {
@@ -77,86 +106,69 @@ public final class Store: Sendable {
           }
         }
 
-        return actionsAccumulator.isEmpty ? nil : actionsAccumulator
-      }
-
-    let allActions = AsyncThrowingStream<[Action], any Error> { continuation in
-      let task = Task {
-        await withTaskGroup(of: (any Error)?.self) { group in
-          group.addTask {
-            for await action in actions {
-              guard !Task.isCancelled else {
-                return nil
-              }
-              continuation.yield([action])
-            }
-            return nil
-          }
-          group.addTask {
-            do {
-              for try await action in applyUIEventsActions {
-                guard !Task.isCancelled else {
-                  return nil
-                }
-                continuation.yield(action)
-              }
-              return nil
-            } catch {
-              return error
-            }
-          }
-          for await error in group {
-            if let error {
-              continuation.finish(throwing: error)
-              return
-            }
-          }
-          continuation.finish()
+        if !actionsAccumulator.isEmpty {
+          reductionStage.submit(actionsAccumulator)
         }
-      }
-      continuation.onTermination = { _ in
-        task.cancel()
-      }
-    }
-
-    updates = AsyncStream<(state: State, updates: State.Updates)> { [alertsContinuation] continuation in
-      Task {
-        var state = initialState
-        var updates = State.Updates()
-        continuation.yield((state, updates))
-
-        do {
-          for try await actions in allActions {
-            guard !Task.isCancelled else {
-              return
-            }
-
-            for action in actions {
-              let newUpdates = action.apply(to: &state) { error in
-                alertsContinuation.yield(.init(error))
-              }
-              updates.formUnion(newUpdates)
-
-              if updates.needFlush {
-                continuation.yield((state, updates))
-                updates = .init()
-              }
-            }
-          }
-        } catch {
+      },
+      onFinish: { [alertsContinuation] error in
+        if let error {
           alertsContinuation.yield(.init(error))
         }
-
-        continuation.finish()
+        reductionStage.finish()
       }
-    }
+    )
+  }
+
+  deinit {
+    cancel()
+  }
+
+  /// Stops reading neovim output and ends `alerts`, `updates` ends once already submitted actions are reduced.
+  public nonisolated func cancel() {
+    stopReading()
+    reductionStage.finish()
+    alertsContinuation.finish()
   }
 
   public nonisolated func dispatch(_ action: Action) {
-    actionsContinuation.yield(action)
+    reductionStage.submitWithoutWaiting([action])
   }
 
   public nonisolated func show(alert: Alert) {
     alertsContinuation.yield(alert)
   }
 }
+
+/// Owns the reduced `State`, only accessed from the reduction stage thread.
+private final class Reducer: @unchecked Sendable {
+  private var state: State
+  private var updates = State.Updates()
+  private let updatesContinuation: AsyncStream<(state: State, updates: State.Updates)>.Continuation
+  private let alertsContinuation: AsyncStream<Alert>.Continuation
+
+  init(
+    state: State,
+    updatesContinuation: AsyncStream<(state: State, updates: State.Updates)>.Continuation,
+    alertsContinuation: AsyncStream<Alert>.Continuation
+  ) {
+    self.state = state
+    self.updatesContinuation = updatesContinuation
+    self.alertsContinuation = alertsContinuation
+  }
+
+  func apply(_ actions: [Action]) {
+    for action in actions {
+      let newUpdates = action.apply(to: &state) { [alertsContinuation] error in
+        alertsContinuation.yield(.init(error))
+      }
+      updates.formUnion(newUpdates)
+
+      if updates.needFlush {
+        // Rows written by grid_line since the last flush are rebuilt once, right before publishing.
+        state.materializePendingLines()
+        updatesContinuation.yield((state, updates))
+        updates = .init()
+      }
+    }
+  }
+}
@@ -64,6 +64,18 @@ public struct Metadata: @unchecked Sendable {
                 .name
             )(type: \(rawTypeIdentifier), data: \(rawDataIdentifier))
             """
+          },
+          valueViewDecoder: { expr, name in
+            var capitalizedName = name.first?.uppercased() ?? ""
+            capitalizedName += name.dropFirst()
+            let rawExtIdentifier = "raw\(capitalizedName)Ext"
+            return """
+            let \(rawExtIdentifier) = \(expr).ext,
+            let \(name) = References.\(
+              type
+                .name
+            )(type: \(rawExtIdentifier).type, data: \(rawExtIdentifier).data)
+            """
           }
         )
       }
@@ -181,10 +193,19 @@ public struct Metadata: @unchecked Sendable {
           throw Failure("Could not parse ui_event", rawUIEvent)
         }
 
+        var parameters = rawParameters
+          .compactMap { Metadata.Parameter($0, types: types) }
+
+        if
+          name == "grid_line",
+          let index = parameters.firstIndex(where: { $0.name == "data" })
+        {
+          parameters[index].type.custom = .gridLineCells
+        }
+
         return .init(
           name: name,
-          parameters: rawParameters
-            .compactMap { Metadata.Parameter($0, types: types) }
+          parameters: parameters
         )
       },
 
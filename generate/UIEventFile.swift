@@ -222,6 +222,144 @@ public struct UIEventFile: GeneratableFile {
 
               """ as ExprSyntax
             }
+
+            try InitializerDeclSyntax(
+              "init(redrawNotificationParameters: ValueView.Elements) throws"
+            ) {
+              """
+              var accumulator = [UIEvent]()
+              accumulator.reserveCapacity(redrawNotificationParameters.count)
+
+              """ as DeclSyntax
+
+              try ForStmtSyntax(
+                "for rawParameter in redrawNotificationParameters"
+              ) {
+                StmtSyntax(
+                  """
+                  guard
+                    let rawUIEvents = rawParameter.array,
+                    let uiEventName = rawUIEvents.first?.string
+                  else {
+                    throw Failure(Value(rawParameter))
+                  }
+
+                  """
+                )
+
+                try SwitchExprSyntax("switch uiEventName") {
+                  try SwitchCaseListSyntax {
+                    for uiEvent in metadata.uiEvents {
+                      let structName = uiEvent.name
+                        .camelCasedAssumingSnakeCased(capitalized: true)
+
+                      let caseName = uiEvent.name
+                        .camelCasedAssumingSnakeCased(capitalized: false)
+
+                      try SwitchCaseSyntax("case \(literal: uiEvent.name):") {
+                        if !uiEvent.parameters.isEmpty {
+                          """
+                          var localAccumulator = [UIEvent.\(raw: structName)]()
+                          localAccumulator.reserveCapacity(rawUIEvents.count - 1)
+
+                          """ as DeclSyntax
+                        }
+
+                        try ForStmtSyntax(
+                          "for rawUIEvent in rawUIEvents.dropFirst()"
+                        ) {
+                          let (valueParameters, otherParameters) = uiEvent
+                            .parameters
+                            .enumerated()
+                            .partitioned(by: {
+                              $0.element.type.swift[case: \.value] == nil
+                            })
+
+                          let guardConditions = [
+                            [
+                              "let rawUIEventParameters = rawUIEvent.array",
+                              "rawUIEventParameters.count == \(uiEvent.parameters.count)",
+                            ],
+                            otherParameters.map { index, parameter -> String in
+                              let identifier = parameter.name
+                                .camelCasedAssumingSnakeCased(
+                                  capitalized: false
+                                )
+                              return parameter.type.wrapWithValueViewDecoder(
+                                "rawUIEventParameters[\(index)]",
+                                name: identifier
+                              )
+                            },
+                          ]
+                            .flatMap(\.self)
+                            .joined(separator: ", ")
+
+                          StmtSyntax(
+                            """
+                            guard \(raw: guardConditions) else {
+                              throw Failure(Value(rawUIEvent))
+                            }
+
+                            """
+                          )
+
+                          for (index, parameter) in valueParameters {
+                            let identifier = parameter.name
+                              .camelCasedAssumingSnakeCased(capitalized: false)
+
+                            """
+                            let \(raw: identifier) = Value(rawUIEventParameters[\(raw: index)])
+
+                            """ as DeclSyntax
+                          }
+
+                          if !uiEvent.parameters.isEmpty {
+                            let associatedValuesSignature = uiEvent.parameters
+                              .map { parameter in
+                                let name = parameter.name
+                                  .camelCasedAssumingSnakeCased(
+                                    capitalized: false
+                                  )
+                                return "\(name): \(name)"
+                              }
+                              .joined(separator: ", ")
+
+                            """
+                            localAccumulator.append(
+                              .init(\(raw: associatedValuesSignature))
+                            )
+
+                            """ as ExprSyntax
+
+                          } else {
+                            """
+                            accumulator.append(.\(raw: caseName))
+
+                            """ as ExprSyntax
+                          }
+                        }
+
+                        if !uiEvent.parameters.isEmpty {
+                          """
+                          accumulator.append(.\(raw: caseName)(localAccumulator))
+
+                          """ as ExprSyntax
+                        }
+                      }
+                    }
+
+                    SwitchCaseSyntax("default:") {
+                      "throw Failure(Value(rawParameter))" as StmtSyntax
+                    }
+                  }
+                }
+              }
+
+              """
+              self = accumulator
+
+              """ as ExprSyntax
+            }
           }
         }
       }
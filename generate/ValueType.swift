@@ -4,10 +4,23 @@ import CasePaths
 
 public struct ValueType: Sendable {
   public struct Custom: Sendable {
+    public static let gridLineCells = Custom(
+      signature: "GridLineCells",
+      valueEncoder: ("", ".value"),
+      valueDecoder: { expr, name in
+        "let \(name) = GridLineCells(\(expr))"
+      },
+      valueViewDecoder: { expr, name in
+        "let \(name) = GridLineCells(\(expr))"
+      }
+    )
+
     public var signature: String
     public var valueEncoder: (prefix: String, suffix: String)
     public var valueDecoder: @Sendable (_ expr: String, _ name: String)
       -> String
+    public var valueViewDecoder: @Sendable (_ expr: String, _ name: String)
+      -> String
   }
 
   @CasePathable
@@ -155,4 +168,39 @@ public struct ValueType: Sendable {
       expr
     }
   }
+
+  public func wrapWithValueViewDecoder(_ expr: String, name: String) -> String {
+    switch swift {
+    case .unsignedInteger:
+      "let \(name) = \(expr).integer.flatMap(UInt.init(exactly:))"
+
+    case .integer:
+      "let \(name) = \(expr).integer"
+
+    case .float:
+      "let \(name) = \(expr).float"
+
+    case .string:
+      "let \(name) = \(expr).string"
+
+    case .boolean:
+      "let \(name) = \(expr).boolean"
+
+    case .dictionary:
+      "case let .dictionary(\(name)) = Value(\(expr))"
+
+    case .array:
+      "let \(name) = \(expr).array?.map({ Value($0) })"
+
+    case .binary:
+      "let \(name) = \(expr).binary"
+
+    case let .custom(custom):
+      custom.valueViewDecoder(expr, name)
+
+    case .value:
+      // `Value` parameters are decoded after the guard, there is nothing to bind or fail here.
+      preconditionFailure("Value parameter \(name) has no value view guard condition")
+    }
+  }
 }
@@ -31,5 +31,248 @@ struct SpeedTuner: AsyncParsableCommand {
       print("values: \(values.count)")
     }
     print("duration \(duration)")
+    customDump(unpacker.zoneStatistics, name: "zone statistics")
+
+    let valueRedrawDuration = try ContinuousClock().measure {
+      var uiEventsCount = 0
+      for value in try Unpacker().unpack(data) {
+        guard
+          case let .notification(notification) = try Message(value: value),
+          notification.method == "redraw"
+        else {
+          continue
+        }
+        uiEventsCount += try [UIEvent](
+          rawRedrawNotificationParameters: notification.parameters
+        ).count
+      }
+      print("value path ui events: \(uiEventsCount)")
+    }
+    print("value path redraw duration \(valueRedrawDuration)")
+
+    let viewRedrawDuration = try ContinuousClock().measure {
+      var uiEventsCount = 0
+      try Unpacker().unpack(data) { views in
+        for view in views {
+          guard
+            case let .notification(method, parameters) = try Message.View(view),
+            method == "redraw"
+          else {
+            continue
+          }
+          uiEventsCount += try [UIEvent](
+            redrawNotificationParameters: parameters
+          ).count
+        }
+      }
+      print("view path ui events: \(uiEventsCount)")
+    }
+    print("view path redraw duration \(viewRedrawDuration)")
+
+    try measurePacking()
+    measureIntKeyedDictionary()
+  }
+
+  private func measurePacking() throws {
+    let line = String(repeating: "packing benchmark line ", count: 4)
+    let payloads: [(name: String, value: Value)] = [
+      (
+        "nvim_buf_set_lines",
+        Message.Request(
+          id: 0,
+          method: "nvim_buf_set_lines",
+          parameters: [
+            .integer(0),
+            .integer(0),
+            .integer(-1),
+            false,
+            .array(.init(repeating: .string(line), count: 100_000)),
+          ]
+        ).makeValue()
+      ),
+      (
+        "nvim_exec_lua",
+        Message.Request(
+          id: 0,
+          method: "nvim_exec_lua",
+          parameters: [
+            .string(String(repeating: line + "\n", count: 50000)),
+            .array([]),
+          ]
+        ).makeValue()
+      ),
+    ]
+    let iterations = 20
+    let allocationIterations = 5
+
+    for (name, value) in payloads {
+      let packer = Packer()
+      var packedBytesCount = 0
+      let packerDuration = ContinuousClock().measure {
+        for _ in 0 ..< iterations {
+          packedBytesCount += packer.pack(value).count
+        }
+      }
+      print("\(name) Packer: \(bytesPerSecond(packedBytesCount, packerDuration))")
+
+      let vectorPacker = VectorPacker()
+      var vectorPackedBytesCount = 0
+      var copiedBytesCount = 0
+      let vectorPackerDuration = ContinuousClock().measure {
+        for _ in 0 ..< iterations {
+          let output = vectorPacker.pack(value)
+          vectorPackedBytesCount += output.count
+          copiedBytesCount += output.copiedBytesCount
+        }
+      }
+      print(
+        "\(name) VectorPacker: \(bytesPerSecond(vectorPackedBytesCount, vectorPackerDuration)), copied \(copiedBytesCount) of \(vectorPackedBytesCount) bytes"
+      )
+
+      let packerAllocations = liveAllocations(iterations: allocationIterations) {
+        packer.pack(value)
+      }
+      let vectorPackerAllocations = liveAllocations(iterations: allocationIterations) {
+        vectorPacker.pack(value)
+      }
+      print(
+        "\(name) live allocations per packed message, Packer: \(packerAllocations.blocksCount) blocks, \(packerAllocations.bytesCount) bytes, VectorPacker: \(vectorPackerAllocations.blocksCount) blocks, \(vectorPackerAllocations.bytesCount) bytes"
+      )
+    }
+  }
+
+  /// Malloc blocks and bytes each result of `body` keeps allocated while it is alive, measured
+  /// with `malloc_zone_statistics` deltas over all zones. Temporary allocations freed inside `body`
+  /// do not show up, the statistics only report what is in use.
+  private func liveAllocations<Result>(
+    iterations: Int,
+    _ body: () -> Result
+  )
+    -> (blocksCount: Int, bytesCount: Int)
+  {
+    func statistics() -> malloc_statistics_t {
+      var statistics = malloc_statistics_t()
+      malloc_zone_statistics(nil, &statistics)
+      return statistics
+    }
+
+    var results = [Result]()
+    results.reserveCapacity(iterations)
+    let before = statistics()
+    for _ in 0 ..< iterations {
+      results.append(body())
+    }
+    let after = statistics()
+    withExtendedLifetime(results) { }
+
+    return (
+      (Int(after.blocks_in_use) - Int(before.blocks_in_use)) / iterations,
+      (Int(after.size_in_use) - Int(before.size_in_use)) / iterations
+    )
+  }
+
+  /// Compares `IntKeyedDictionary` with `Dictionary` under the access patterns of the state reducer.
+  private func measureIntKeyedDictionary() {
+    let highlightsCount = 5000
+    let highlightDefineIterations = 200
+
+    func highlightDefine<D>(
+      _ dictionary: inout D,
+      set: (inout D, Int, Int) -> Void,
+      get: (D, Int) -> Int?
+    )
+      -> Int
+    {
+      var checksum = 0
+      for iteration in 0 ..< highlightDefineIterations {
+        for id in 1 ... highlightsCount {
+          set(&dictionary, id, id &+ iteration)
+          checksum &+= get(dictionary, (id &* 31) % highlightsCount) ?? 0
+        }
+      }
+      return checksum
+    }
+
+    let liveGridsCount = 16
+    let gridChurnIterations = 1_000_000
+
+    func gridChurn<D>(
+      _ dictionary: inout D,
+      set: (inout D, Int, Int?) -> Void,
+      get: (D, Int) -> Int?
+    )
+      -> Int
+    {
+      var checksum = 0
+      for id in 1 ... liveGridsCount {
+        set(&dictionary, id, id)
+      }
+      for iteration in 0 ..< gridChurnIterations {
+        let id = iteration + liveGridsCount + 1
+        set(&dictionary, id, iteration)
+        set(&dictionary, id - liveGridsCount, nil)
+        checksum &+= get(dictionary, id - 1) ?? 0
+      }
+      return checksum
+    }
+
+    var intKeyedDictionary = IntKeyedDictionary<Int>()
+    let intKeyedHighlightDuration = ContinuousClock().measure {
+      _ = highlightDefine(
+        &intKeyedDictionary,
+        set: { $0[$1] = $2 },
+        get: { $0[$1] }
+      )
+    }
+    var dictionary = [Int: Int]()
+    let dictionaryHighlightDuration = ContinuousClock().measure {
+      _ = highlightDefine(
+        &dictionary,
+        set: { $0[$1] = $2 },
+        get: { $0[$1] }
+      )
+    }
+    print("highlight define IntKeyedDictionary: \(intKeyedHighlightDuration), Dictionary: \(dictionaryHighlightDuration)")
+
+    intKeyedDictionary = .init()
+    let intKeyedChurnDuration = ContinuousClock().measure {
+      _ = gridChurn(
+        &intKeyedDictionary,
+        set: { $0[$1] = $2 },
+        get: { $0[$1] }
+      )
+    }
+    dictionary = [:]
+    let dictionaryChurnDuration = ContinuousClock().measure {
+      _ = gridChurn(
+        &dictionary,
+        set: { $0[$1] = $2 },
+        get: { $0[$1] }
+      )
+    }
+    print("grid churn IntKeyedDictionary: \(intKeyedChurnDuration), Dictionary: \(dictionaryChurnDuration)")
+
+    let grownKeysCount = 100_000
+    var shrinkingDictionary = IntKeyedDictionary<Int>()
+    for key in 0 ..< grownKeysCount {
+      shrinkingDictionary[key] = key
+    }
+    let grownCapacity = shrinkingDictionary.capacity
+    for key in liveGridsCount ..< grownKeysCount {
+      shrinkingDictionary[key] = nil
+    }
+    let shrunkCapacity = shrinkingDictionary.capacity
+    print(
+      "IntKeyedDictionary capacity after removals, dense: \(grownCapacity.dense) -> \(shrunkCapacity.dense), sparse: \(grownCapacity.sparse) -> \(shrunkCapacity.sparse)"
+    )
+    precondition(
+      shrunkCapacity.dense < grownCapacity.dense / 4 && shrunkCapacity.sparse < grownCapacity.sparse / 4,
+      "IntKeyedDictionary did not release storage after removals"
+    )
+  }
+
+  private func bytesPerSecond(_ count: Int, _ duration: Duration) -> String {
+    let seconds = Double(duration.components.seconds) + Double(duration.components.attoseconds) / 1e18
+    return "\(Int(Double(count) / seconds / 1_000_000)) MB/s"
   }
 }